@@ -0,0 +1,132 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Batch mode scaling: the same set of files assembled with 1 to N worker
+// threads, each file writing its own image into an output directory.
+// The assembler prints the file names to stdout; the table goes to stderr,
+// so run it as ./batch_bench > /dev/null.
+
+#include "../src/include/assembler.h"
+#include "bench.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief One block of a generated file.
+ */
+static const char *const block =
+    "label%d:\n"
+    " mov ax, 0x1234\n"
+    " mov si, [bx+di+8]\n"
+    " mov [bp-2], ax\n"
+    " add ax, 5\n"
+    " mov si, msg%d\n"
+    ".loop:\n"
+    " jne .loop\n"
+    " jmp label%d\n"
+    "msg%d db 'hello', 0\n";
+
+/** Files in the batch. */
+static constexpr int FILES = 64;
+
+/** Blocks per file. */
+static constexpr int BLOCKS = 2000;
+
+/** Timed rounds per thread count; the fastest one is reported. */
+static constexpr int ROUNDS = 3;
+
+/**
+ * @brief Writes the batch into dir and returns the file names.
+ */
+static std::vector<std::string> write_files(const std::filesystem::path &dir)
+{
+    std::filesystem::create_directories(dir);
+    const std::string source = bench_source(block, BLOCKS);
+    std::vector<std::string> names;
+    for (int f = 0; f < FILES; f++)
+    {
+        names.push_back((dir / ("file" + std::to_string(f) + ".asm")).string());
+        std::ofstream(names.back()) << source;
+    }
+    return names;
+}
+
+/**
+ * @brief Returns the best wall time in seconds of assembling the batch
+ * with the given number of threads, the images going into output.
+ */
+static double bench_threads(const std::vector<const char *> &args, const std::string &output, int threads)
+{
+    return bench_best(ROUNDS, [&] {
+        int status = 0;
+        const double seconds = bench_time(
+            [&] { status = assemble_files(args.data(), static_cast<int>(args.size()), threads, output.c_str(), 0); });
+        if (status != 0)
+        {
+            std::fprintf(stderr, "batch_bench: the generated files did not assemble\n");
+            std::exit(1);
+        }
+        return seconds;
+    });
+}
+
+int main(int argc, char **argv)
+{
+    // The largest thread count can be given; the default is one per hardware thread
+    const int max_threads = argc > 1 ? std::max(1, std::atoi(argv[1]))
+                                     : static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / "easm_batch_bench";
+    const std::vector<std::string> names = write_files(dir);
+    const std::string output = (dir / "bin").string();
+    std::vector<const char *> args;
+    for (const std::string &name : names)
+        args.push_back(name.c_str());
+
+    std::vector<int> counts;
+    for (int threads = 1; threads < max_threads; threads *= 2)
+        counts.push_back(threads);
+    counts.push_back(max_threads);
+
+    std::fprintf(stderr, "%8s %10s %10s %10s\n", "threads", "ms", "files/s", "speedup");
+    double single = 0.0;
+    for (int threads : counts)
+    {
+        const double seconds = bench_threads(args, output, threads);
+        if (threads == 1)
+            single = seconds;
+        std::fprintf(stderr, "%8d %10.3f %10.1f %9.2fx\n", threads, seconds * 1e3, FILES / seconds, single / seconds);
+    }
+
+    // Every file has to have written its own image
+    const auto images = std::distance(std::filesystem::directory_iterator(output), std::filesystem::directory_iterator());
+    std::filesystem::remove_all(dir);
+    if (images != FILES)
+    {
+        std::fprintf(stderr, "batch_bench: %ld images written for %d files\n", static_cast<long>(images), FILES);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Scaffolding shared by the benchmarks: generated sources and best-of-N timing.
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <algorithm>
+#include <charconv>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/** Timed rounds of a benchmark that does not set its own; the fastest one is reported. */
+inline constexpr int BENCH_ROUNDS = 5;
+
+/**
+ * @brief Appends copy i of a block template to the source: the block with
+ * every %d replaced by i, so each copy defines its own names.
+ */
+inline void bench_append_block(std::string &source, const char *block, int i)
+{
+    char number[16];
+    const char *end = std::to_chars(number, number + sizeof(number), i).ptr;
+    const std::string_view index(number, static_cast<size_t>(end - number));
+    for (const char *c = block; *c; c++)
+    {
+        if (c[0] == '%' && c[1] == 'd')
+        {
+            source += index;
+            c++;
+        }
+        else
+            source += *c;
+    }
+}
+
+/**
+ * @brief Returns a source made of copies 0 to blocks - 1 of a block template.
+ */
+inline std::string bench_source(const char *block, int blocks)
+{
+    std::string source;
+    for (int i = 0; i < blocks; i++)
+        bench_append_block(source, block, i);
+    return source;
+}
+
+/**
+ * @brief Returns the wall time in seconds of one call of body.
+ */
+template <typename Body>
+double bench_time(Body &&body)
+{
+    const auto start = std::chrono::steady_clock::now();
+    body();
+    const auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+/**
+ * @brief Runs round the given number of times and returns the smallest of
+ * the times in seconds it returns; a round times only the part it measures.
+ */
+template <typename Round>
+double bench_best(int rounds, Round &&round)
+{
+    double best = 1e30;
+    for (int i = 0; i < rounds; i++)
+        best = std::min(best, round());
+    return best;
+}
+
+#endif // BENCH_H
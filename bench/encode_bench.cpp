@@ -0,0 +1,109 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Microbenchmark of pass 2: encode latency per instruction, for each operand form.
+
+#include "../src/include/asm_context.h"
+#include "../src/include/parser.h"
+#include "../src/include/parser_handler.h"
+#include "../src/include/relax.h"
+#include "bench.h"
+#include <cstdio>
+#include <exception>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One benchmarked instruction and the name of its form.
+ */
+struct BenchCase
+{
+    const char *form;
+    const char *line;
+};
+
+static const BenchCase cases[] = {
+    {"none", " nop"},
+    {"reg16, imm16", " mov ax, 0x1234"},
+    {"reg16, reg16", " mov cx, dx"},
+    {"reg16, [base+index+disp8]", " mov si, [bx+di+8]"},
+    {"[base+disp8], reg16", " mov [bp-2], ax"},
+    {"reg16, [disp16]", " mov di, [0x200]"},
+    {"reg16, seg:[index]", " mov ax, es:[si]"},
+    {"reg16, [label]", " mov ax, [table]"},
+    {"jcc, widened to rel16", " jne back"},
+};
+
+/** Instructions per case; small enough for the IR and the image to stay in cache. */
+static constexpr int INSTRUCTIONS = 4096;
+
+/** Timed rounds per case; the fastest one is reported. */
+static constexpr int ROUNDS = 300;
+
+/**
+ * @brief Runs pass 1 on INSTRUCTIONS copies of a line and returns the best time per instruction of pass 2.
+ */
+static double bench_case(const BenchCase &bench)
+{
+    std::string source = "back:\n";
+    for (int i = 0; i < INSTRUCTIONS; i++)
+    {
+        source += bench.line;
+        source += '\n';
+    }
+    source += "table:\n";
+
+    AsmContext ctx;
+    ctx.filename = "bench";
+    ctx.listing = false;
+    Lexer lexer;
+    lexer_init(&lexer, source.c_str(), source.size(), "bench");
+    token_store_init(&ctx.tokens, source.c_str());
+    if (token_store_fill(&ctx.tokens, &lexer) != 0)
+        throw AssemblyError("cannot store the tokens");
+    parser_process_lines(ctx, 1);
+    relax_branches(ctx);
+    token_store_free(&ctx.tokens);
+    if (ctx.ir.size() != INSTRUCTIONS)
+        throw AssemblyError(std::string("pass 1 failed on") + bench.line);
+
+    std::vector<uint8_t> image(ctx.ir.back().address + ctx.ir.back().size);
+    const double best = bench_best(ROUNDS, [&] {
+        return bench_time([&] {
+            for (const IrInstr &instr : ctx.ir)
+                encodeInstruction(ctx, instr, image.data() + instr.address, nullptr);
+        });
+    });
+    return best * 1e9 / INSTRUCTIONS;
+}
+
+int main()
+{
+    try
+    {
+        std::printf("%-28s %10s\n", "form", "ns/instr");
+        for (const BenchCase &bench : cases)
+            std::printf("%-28s %10.2f\n", bench.form, bench_case(bench));
+    }
+    catch (const std::exception &ex)
+    {
+        std::fprintf(stderr, "encode_bench: %s\n", ex.what());
+        return 1;
+    }
+    return 0;
+}
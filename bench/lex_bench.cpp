@@ -0,0 +1,73 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Lexer throughput in MB/s on a large generated corpus.
+
+#include "../src/include/lexer.h"
+#include "../src/include/scan.h"
+#include "bench.h"
+#include <cstdio>
+#include <string>
+
+/**
+ * @brief One block of the corpus: the kinds of lines a real source is made of.
+ */
+static const char *const block =
+    "; routine %d: copy a string and print it\n"
+    "copy%d:\n"
+    "    mov si, msg%d          ; source\n"
+    "    mov di, [bx+si+0x10]\n"
+    "    mov ax, es:[di]\n"
+    "    add ax, 5\n"
+    ".loop:\n"
+    "    mov cx, 0FFh\n"
+    "    mov dx, 0b1010_1010\n"
+    "    jne .loop\n"
+    "    call print\n"
+    "msg%d db 'Hello; \"world\"', 13, 10, 0\n"
+    "table%d dw 0x1234, 42, 0q17\n"
+    "LEN%d equ 64\n"
+    "\n";
+
+/** Approximate size of the corpus. */
+static constexpr size_t SOURCE_BYTES = 32 << 20;
+
+int main()
+{
+    std::string source;
+    source.reserve(SOURCE_BYTES + 1024);
+    for (int i = 0; source.size() < SOURCE_BYTES; i++)
+        bench_append_block(source, block, i);
+
+    size_t tokens = 0;
+    const double best = bench_best(BENCH_ROUNDS, [&] {
+        Lexer lexer;
+        lexer_init(&lexer, source.c_str(), source.size(), "lex_bench");
+        tokens = 0;
+        return bench_time([&] {
+            while (lexer_next(&lexer).type != TOKEN_EOF)
+                tokens++;
+        });
+    });
+
+    std::printf("%10s %10s %10s %12s %10s\n", "MB", "tokens", "MB/s", "Mtokens/s", "scanning");
+    std::printf("%10.1f %10zu %10.1f %12.1f %10s\n", static_cast<double>(source.size()) / 1e6, tokens,
+                static_cast<double>(source.size()) / 1e6 / best, static_cast<double>(tokens) / 1e6 / best,
+                scan_implementation());
+    return 0;
+}
@@ -0,0 +1,91 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Pass 1 throughput in lines per second on a large generated source.
+
+#include "../src/include/asm_context.h"
+#include "../src/include/parser.h"
+#include "bench.h"
+#include <cstdio>
+#include <exception>
+#include <string>
+
+/**
+ * @brief One block of the generated source: a line of each kind pass 1 dispatches on.
+ */
+static const char *const block =
+    "label%d:\n"
+    " mov ax, 0x1234\n"
+    " mov cx, dx\n"
+    " mov si, [bx+di+8]\n"
+    " mov [bp-2], ax\n"
+    " mov di, es:[si]\n"
+    " add ax, 5\n"
+    " mov si, msg%d\n"
+    ".loop:\n"
+    " jne .loop\n"
+    " jmp label%d\n"
+    "msg%d db 'hello', 0\n"
+    "size%d equ 7\n"
+    " nop\n";
+
+/** Lines in one block. */
+static constexpr int BLOCK_LINES = 14;
+
+/** Blocks in the source. */
+static constexpr int BLOCKS = 100000;
+
+/**
+ * @brief Lexes the source into a fresh context and returns the time of pass 1 in seconds.
+ */
+static double bench_round(const std::string &source)
+{
+    AsmContext ctx;
+    ctx.filename = "parse_bench";
+    Lexer lexer;
+    lexer_init(&lexer, source.c_str(), source.size(), "parse_bench");
+    token_store_init(&ctx.tokens, source.c_str());
+    if (token_store_fill(&ctx.tokens, &lexer) != 0)
+        throw AssemblyError("cannot store the tokens");
+
+    const double seconds = bench_time([&] { parser_process_lines(ctx, 1); });
+
+    token_store_free(&ctx.tokens);
+    if (ctx.failed || ctx.ir.empty())
+        throw AssemblyError("the generated source did not assemble: " + ctx.diagnostics.str());
+    return seconds;
+}
+
+int main()
+{
+    try
+    {
+        const std::string source = bench_source(block, BLOCKS);
+        const double best = bench_best(BENCH_ROUNDS, [&] { return bench_round(source); });
+
+        const double lines = static_cast<double>(BLOCKS) * BLOCK_LINES;
+        std::printf("%10s %10s %12s %10s\n", "lines", "ms", "lines/s", "ns/line");
+        std::printf("%10.0f %10.3f %12.0f %10.1f\n", lines, best * 1e3, lines / best, best * 1e9 / lines);
+    }
+    catch (const std::exception &ex)
+    {
+        std::fprintf(stderr, "parse_bench: %s\n", ex.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,101 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Regression benchmark of the lexer on lines full of quoted strings: the
+// time per byte must not grow with the number of strings on a line.
+
+#include "../src/include/lexer.h"
+#include "bench.h"
+#include <cstdio>
+#include <string>
+
+/** Strings per line of each case; a quadratic lexer slows down 8x from the first to the last. */
+static const int strings_per_line[] = {100, 200, 400, 800};
+
+/** Approximate size of the generated source of every case. */
+static constexpr size_t SOURCE_BYTES = 4 << 20;
+
+/** Timed rounds per case; the fastest one is reported. */
+static constexpr int ROUNDS = 10;
+
+/** Largest allowed ratio of the time per byte of a case to that of the first case. */
+static constexpr double MAX_SLOWDOWN = 2.0;
+
+/**
+ * @brief Builds lines of count quoted strings that hold the characters
+ * that used to trigger a rescan of the line: ';', '\'' and '"'.
+ */
+static std::string make_source(int count)
+{
+    std::string line = "msg db ";
+    for (int i = 0; i < count; i++)
+    {
+        if (i > 0)
+            line += ", ";
+        line += (i % 2) ? "\"x'y;z\"" : "'a\";b'";
+    }
+    line += " ; done\n";
+
+    std::string source;
+    source.reserve(SOURCE_BYTES + line.size());
+    while (source.size() < SOURCE_BYTES)
+        source += line;
+    return source;
+}
+
+/**
+ * @brief Returns the best time in nanoseconds per source byte of lexing the source.
+ */
+static double bench_case(const std::string &source, size_t &tokens)
+{
+    const double best = bench_best(ROUNDS, [&] {
+        Lexer lexer;
+        lexer_init(&lexer, source.c_str(), source.size(), "quote_bench");
+        tokens = 0;
+        return bench_time([&] {
+            while (lexer_next(&lexer).type != TOKEN_EOF)
+                tokens++;
+        });
+    });
+    return best * 1e9 / static_cast<double>(source.size());
+}
+
+int main()
+{
+    std::printf("%14s %10s %10s %10s %10s\n", "strings/line", "tokens", "MB/s", "ns/byte", "slowdown");
+    double first = 0.0;
+    bool linear = true;
+    for (int count : strings_per_line)
+    {
+        const std::string source = make_source(count);
+        size_t tokens = 0;
+        const double ns_per_byte = bench_case(source, tokens);
+        if (count == strings_per_line[0])
+            first = ns_per_byte;
+        const double slowdown = ns_per_byte / first;
+        linear = linear && slowdown <= MAX_SLOWDOWN;
+        std::printf("%14d %10zu %10.1f %10.3f %9.2fx\n", count, tokens, 1e3 / ns_per_byte, ns_per_byte, slowdown);
+    }
+
+    if (!linear)
+    {
+        std::fprintf(stderr, "quote_bench: lexing time grows with the number of strings per line\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,60 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "include/arena.h"
+#include "include/stats.h"
+#include <cstring>
+
+// Bytes of the first block of an arena; each next block is bigger
+static const size_t ARENA_FIRST_BLOCK = 64 * 1024;
+
+/**
+ * @class CountedResource
+ * @brief Takes the blocks of the arenas from the heap and counts them.
+ */
+class CountedResource : public std::pmr::memory_resource
+{
+    void *do_allocate(size_t bytes, size_t alignment) override
+    {
+        stats_count_arena_block(bytes);
+        return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *ptr, size_t bytes, size_t alignment) override
+    {
+        std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override
+    {
+        return this == &other;
+    }
+};
+
+static CountedResource counted_heap;
+
+Arena::Arena() : std::pmr::monotonic_buffer_resource(ARENA_FIRST_BLOCK, &counted_heap) {}
+
+std::string_view Arena::keep(std::string_view text)
+{
+    if (text.empty())
+        return {};
+    char *copy = static_cast<char *>(allocate(text.size(), 1));
+    std::memcpy(copy, text.data(), text.size());
+    return std::string_view(copy, text.size());
+}
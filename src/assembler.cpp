@@ -0,0 +1,458 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "include/assembler.h"
+#include "include/asm_context.h"
+#include "include/parser.h"
+#include "include/parser_handler.h"
+#include "include/relax.h"
+#include "include/lexer.h"
+#include "include/source.h"
+#include "include/binary.h"
+#include "include/token_store.h"
+#include "include/errors.h"
+#include "include/stats.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+// Smaller files are parsed on one thread, even with spare threads
+static const size_t PARALLEL_PASS1_MIN_BYTES = 256 * 1024;
+
+// Source bytes a lexer thread gets at least
+static const size_t LEX_CHUNK_MIN = 256 * 1024;
+
+/**
+ * @brief A run of whole lines of a source file, lexed on a thread of its own.
+ */
+struct LexChunk
+{
+    const char *begin = nullptr;  /**< First byte of the chunk; the start of a line. */
+    size_t size = 0;              /**< Size in bytes; the chunk ends just after a '\n' or at the end of the file. */
+    Lexer lexer;                  /**< Counts lines from 1 at the start of the chunk. */
+    TokenStore own{};             /**< Tokens of every chunk but the first, which fills the store of the file. */
+    TokenStore *tokens = nullptr; /**< The store the chunk fills. */
+    //                     token index  error name   line in chunk
+    std::vector<std::tuple<size_t, const char *, int>> errors; /**< Lexer errors, before line numbers are fixed up. */
+    int failed = 0;               /**< errno if the store could not grow, else 0. */
+    bool stopped = false;         /**< A NUL byte in the chunk ended the input there. */
+
+    LexChunk() = default;
+    LexChunk(const LexChunk &) = delete;
+    LexChunk &operator=(const LexChunk &) = delete;
+    ~LexChunk() { token_store_free(&own); }
+};
+
+/**
+ * @brief Keeps a lexer error of a chunk until the chunks are put together.
+ *
+ * The error is tagged with the number of tokens the chunk has stored so
+ * far, so that parser_process_lines() can drop it if pass 1 stops at an
+ * earlier line.
+ */
+static void hold_lexer_error(void *data, const char *error_name, int line, const char *)
+{
+    LexChunk &chunk = *static_cast<LexChunk *>(data);
+    chunk.errors.emplace_back(chunk.tokens->count, error_name, line);
+}
+
+/**
+ * @brief Lexes one chunk into its store.
+ */
+static void lex_chunk(LexChunk &chunk)
+{
+    if (token_store_fill(chunk.tokens, &chunk.lexer) != 0)
+        chunk.failed = errno;
+    chunk.stopped = std::memchr(chunk.begin, '\0', chunk.size) != nullptr;
+}
+
+/**
+ * @brief Runs function(i) for every i in [first, last), the first one on
+ * this thread and each of the others on a thread of its own.
+ *
+ * The other threads time their work as lexing; this thread is expected to
+ * be in the lexing phase already.
+ */
+template <typename Function>
+static void run_each(size_t first, size_t last, Function function)
+{
+    auto timed = [&function](size_t i)
+    {
+        stats_phase_begin(STATS_PHASE_LEX);
+        function(i);
+        stats_phase_end(STATS_PHASE_LEX);
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = first + 1; i < last; i++)
+        pool.emplace_back(timed, i);
+    if (first < last)
+        function(first);
+    for (std::thread &thread : pool)
+        thread.join();
+}
+
+/**
+ * @brief Lexes a source file into the token store of its context.
+ *
+ * A big file is cut at newlines into up to `threads` chunks that are
+ * lexed at the same time into stores of their own. The stores are then
+ * copied behind the first one, again in parallel, with their line
+ * numbers moved past the lines of the chunks before them and their
+ * symbol ids translated to those of the file. A NUL byte
+ * ends the input as it does for a single lexer: the chunks after the
+ * one that has it are dropped.
+ *
+ * Lexer errors end up in ctx.lexer_errors with the same token index and
+ * text as if the file had been lexed in one piece.
+ */
+static void lex_source(AsmContext &ctx, const SourceBuffer &source, size_t threads)
+{
+    const size_t count = std::max<size_t>(1, std::min(threads, source.size / LEX_CHUNK_MIN));
+    std::vector<LexChunk> chunks(count);
+
+    size_t used = 0;
+    const char *begin = source.data;
+    const char *const end = source.data + source.size;
+    while (used < count && begin < end)
+    {
+        const char *chunk_end = end;
+        if (used + 1 < count)
+        {
+            const char *target = std::max(begin, source.data + source.size / count * (used + 1));
+            const void *newline = std::memchr(target, '\n', static_cast<size_t>(end - target));
+            if (newline != nullptr)
+                chunk_end = static_cast<const char *>(newline) + 1;
+        }
+
+        LexChunk &chunk = chunks[used];
+        chunk.begin = begin;
+        chunk.size = static_cast<size_t>(chunk_end - begin);
+        lexer_init(&chunk.lexer, begin, chunk.size, ctx.filename.c_str());
+        chunk.lexer.report = hold_lexer_error;
+        chunk.lexer.report_data = &chunk;
+        chunk.tokens = used == 0 ? &ctx.tokens : &chunk.own;
+        token_store_init(chunk.tokens, source.data);
+        used++;
+        begin = chunk_end;
+    }
+
+    run_each(0, used, [&chunks](size_t i) { lex_chunk(chunks[i]); });
+
+    // Where each chunk goes in the store of the file, and how many source lines come before it
+    std::vector<size_t> token_at(used), line_at(used);
+    std::vector<uint32_t> line_base(used);
+    size_t tokens = 0, lines = 0;
+    uint32_t source_lines = 0;
+    size_t kept = 0;
+    while (kept < used)
+    {
+        const LexChunk &chunk = chunks[kept];
+        if (chunk.failed)
+            throw AssemblyError("Cannot store the tokens: " + std::generic_category().message(chunk.failed));
+        token_at[kept] = tokens;
+        line_at[kept] = lines;
+        line_base[kept] = source_lines;
+        tokens += chunk.tokens->count;
+        lines += chunk.tokens->line_count;
+        source_lines += static_cast<uint32_t>(chunk.lexer.line - 1);
+        kept++;
+        if (chunk.stopped)
+            break;
+    }
+
+    for (size_t i = 0; i < kept; i++)
+    {
+        for (const auto &[index, error_name, line] : chunks[i].errors)
+        {
+            ctx.lexer_errors.emplace_back(token_at[i] + index,
+                                          std::string(error_name) + " - File: " + ctx.filename + ", Line: " +
+                                              std::to_string(line + static_cast<int>(line_base[i])) + "\n");
+        }
+    }
+
+    if (kept > 1)
+    {
+        if (token_store_reserve(&ctx.tokens, tokens, lines) != 0)
+            throw AssemblyError("Cannot store the tokens: " + std::generic_category().message(errno));
+
+        // Symbol ids of the file follow the order names first appear in, chunk by chunk
+        std::vector<std::vector<uint32_t>> symbol_maps(kept);
+        for (size_t i = 1; i < kept; i++)
+        {
+            symbol_maps[i].resize(chunks[i].tokens->symbols.count);
+            if (token_store_map_symbols(&ctx.tokens, chunks[i].tokens, symbol_maps[i].data()) != 0)
+                throw AssemblyError("Cannot store the tokens: " + std::generic_category().message(errno));
+        }
+
+        run_each(1, kept, [&](size_t i)
+                 { token_store_copy(&ctx.tokens, token_at[i], line_at[i], chunks[i].tokens, line_base[i],
+                                    symbol_maps[i].data()); });
+        ctx.tokens.count = tokens;
+        ctx.tokens.line_count = lines;
+    }
+}
+
+/**
+ * @brief Assembles one source file into its context.
+ *
+ * The lexer first fills the token store of the file, then pass 1 parses
+ * its lines into the IR; when a big file may use several threads, both
+ * run in parallel pieces. Branch relaxation fixes the branch sizes and
+ * pass 2 then encodes the IR into the image, which is written to the
+ * output file if there is one. An AssemblyError thrown by either pass
+ * only unwinds C++ frames and ends the assembly of this file alone.
+ */
+static void assemble_file(AsmContext &ctx)
+{
+    SourceBuffer source;
+    if (source_load(ctx.filename.c_str(), &source) != 0)
+    {
+        ctx.diagnostics << ERROR_FILE_NOT_OPENED << ": " << std::generic_category().message(errno) << "\n";
+        ctx.failed = true;
+        return;
+    }
+
+    token_store_init(&ctx.tokens, source.data);
+    stats_count_source_bytes(source.size);
+
+    try
+    {
+        stats_phase_begin(STATS_PHASE_LEX);
+        lex_source(ctx, source, ctx.threads);
+        stats_phase_end(STATS_PHASE_LEX);
+
+        parser_process_lines(ctx, source.size >= PARALLEL_PASS1_MIN_BYTES ? ctx.threads : 1);
+        relax_branches(ctx);
+        encodeInstructions(ctx);
+
+        // A file with errors gets no image, not one with bytes missing
+        if (!ctx.failed && !ctx.output.empty() && binary_write(ctx.output.c_str(), ctx.image.data(), ctx.image.size()) != 0)
+            throw AssemblyError("Cannot write " + ctx.output + ": " + std::generic_category().message(errno));
+    }
+    catch (const std::exception &ex)
+    {
+        stats_phase_abort();
+        ctx.diagnostics << "Fatal error: " << ex.what() << "\n";
+        ctx.failed = true;
+    }
+
+    token_store_free(&ctx.tokens);
+    source_release(&source);
+    stats_count_file();
+}
+
+/**
+ * @brief Replaces @name arguments by the file names listed in the response file.
+ *
+ * @return bool False if a response file could not be read.
+ */
+static bool expand_arguments(const char *const *args, int count, std::vector<std::string> &files)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (args[i][0] != '@')
+        {
+            files.emplace_back(args[i]);
+            continue;
+        }
+
+        std::ifstream response(args[i] + 1);
+        if (!response)
+        {
+            std::fprintf(stderr, "%s: %s\n", ERROR_FILE_NOT_OPENED, args[i] + 1);
+            return false;
+        }
+
+        std::string line;
+        while (std::getline(response, line))
+        {
+            const size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos)
+                continue;
+            const size_t last = line.find_last_not_of(" \t\r");
+            files.push_back(line.substr(first, last - first + 1));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Names the image of every source for -o with several files:
+ * dir/<source name without its extension>.bin.
+ *
+ * @return bool False if dir cannot be created or two sources would write the same image.
+ */
+static bool batch_output_names(const std::vector<std::string> &files, const char *dir,
+                               std::vector<std::string> &names)
+{
+    std::error_code error;
+    std::filesystem::create_directories(dir, error);
+    if (error)
+    {
+        std::fprintf(stderr, "Cannot create %s: %s\n", dir, error.message().c_str());
+        return false;
+    }
+
+    std::set<std::string> used;
+    for (const std::string &file : files)
+    {
+        std::filesystem::path name = std::filesystem::path(dir) / std::filesystem::path(file).stem();
+        name += ".bin";
+        if (!used.insert(name.string()).second)
+        {
+            std::fprintf(stderr, "-o %s: more than one source file would write %s\n", dir, name.string().c_str());
+            return false;
+        }
+        names.push_back(name.string());
+    }
+    return true;
+}
+
+/**
+ * @brief Writes the collected output of a finished file.
+ *
+ * In batch mode the output is preceded by the file name and every
+ * diagnostic line is prefixed with it.
+ */
+static void write_output(AsmContext &ctx, bool batch)
+{
+    if (batch)
+        std::printf("%s:\n", ctx.filename.c_str());
+
+    const std::string out = ctx.out.str();
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    std::fflush(stdout);
+
+    const std::string diagnostics = ctx.diagnostics.str();
+    size_t start = 0;
+    while (start < diagnostics.size())
+    {
+        size_t end = diagnostics.find('\n', start);
+        end = end == std::string::npos ? diagnostics.size() : end + 1;
+        if (batch)
+            std::fprintf(stderr, "%s: ", ctx.filename.c_str());
+        std::fwrite(diagnostics.data() + start, 1, end - start, stderr);
+        start = end;
+    }
+}
+
+int assemble_files(const char *const *args, int count, int jobs, const char *output, int listing)
+{
+    std::vector<std::string> files;
+    if (!expand_arguments(args, count, files))
+        return 1;
+    if (files.empty())
+    {
+        std::fprintf(stderr, "No source files given.\n");
+        return 1;
+    }
+    const size_t n = files.size();
+
+    // One source writes its image to output; several write theirs into the directory output
+    std::vector<std::string> outputs;
+    if (output && n > 1 && !batch_output_names(files, output, outputs))
+        return 1;
+    if (output && n == 1)
+        outputs.emplace_back(output);
+    const size_t cores = jobs > 0 ? static_cast<size_t>(jobs) : std::max(1u, std::thread::hardware_concurrency());
+    const size_t threads = std::min(cores, n);
+
+    // With fewer files than threads, the spare threads work inside a file
+    // A context is freed, arena and all, as soon as its output is written
+    std::vector<std::unique_ptr<AsmContext>> contexts(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        contexts[i] = std::make_unique<AsmContext>();
+        contexts[i]->filename = std::move(files[i]);
+        contexts[i]->threads = std::max<size_t>(1, cores / n);
+        contexts[i]->output = output ? outputs[i] : "";
+        contexts[i]->listing = listing != 0;
+    }
+
+    const bool batch = n > 1;
+    int status = 0;
+
+    if (threads == 1)
+    {
+        for (std::unique_ptr<AsmContext> &ctx : contexts)
+        {
+            assemble_file(*ctx);
+            status |= ctx->failed ? 1 : 0;
+            write_output(*ctx, batch);
+            ctx.reset();
+        }
+        return status;
+    }
+
+    // Workers take the next file from a shared index, so long and short
+    // files balance out by themselves.
+    std::atomic<size_t> next{0};
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::vector<char> done(n, 0);
+
+    auto worker = [&]()
+    {
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < n;
+             i = next.fetch_add(1, std::memory_order_relaxed))
+        {
+            assemble_file(*contexts[i]);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done[i] = 1;
+            }
+            finished.notify_one();
+        }
+    };
+
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (size_t t = 0; t < threads; t++)
+        pool.emplace_back(worker);
+
+    // Write the results in input order while the workers keep going
+    for (size_t i = 0; i < n; i++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&]
+                          { return done[i] != 0; });
+        }
+        status |= contexts[i]->failed ? 1 : 0;
+        write_output(*contexts[i], batch);
+        contexts[i].reset();
+    }
+
+    for (std::thread &thread : pool)
+        thread.join();
+    return status;
+}
@@ -0,0 +1,56 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Memory arena of one assembly.
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <memory_resource>
+#include <string_view>
+
+/**
+ * @class Arena
+ * @brief A bump allocator for everything one assembly builds.
+ *
+ * The IR, the label and symbol tables and the encoded image of a file are
+ * carved out of a few big blocks, which are all returned to the heap at
+ * once when the arena is destroyed; nothing is freed one by one before
+ * that. The blocks are counted in the statistics. An arena is not
+ * thread-safe: threads that build something at the same time need arenas
+ * of their own.
+ */
+class Arena : public std::pmr::monotonic_buffer_resource
+{
+public:
+    Arena();
+    Arena(const Arena &) = delete;
+    Arena &operator=(const Arena &) = delete;
+
+    /**
+     * @brief Copies a string into the arena.
+     *
+     * @return std::string_view The copy, which lives as long as the arena.
+     */
+    std::string_view keep(std::string_view text);
+};
+
+#endif // __cplusplus
+#endif // ARENA_H
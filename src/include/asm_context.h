@@ -0,0 +1,175 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Per-assembly state.
+
+#ifndef ASM_CONTEXT_H
+#define ASM_CONTEXT_H
+
+#ifdef __cplusplus
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory_resource>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include "lexer.h"
+#include "token_store.h"
+#include "arena.h"
+#include "ir.h"
+
+/**
+ * @class AssemblyError
+ * @brief Thrown for an error that stops the assembly of one file.
+ *
+ * The driver reports it as "Fatal error: <message>" in the diagnostics of
+ * that file; the other files of a batch are still assembled.
+ */
+class AssemblyError : public std::exception
+{
+public:
+    explicit AssemblyError(const char *message) : message_(message) {}
+    explicit AssemblyError(std::string message) : message_(std::move(message)) {}
+
+    const char *what() const noexcept override { return message_.c_str(); }
+
+private:
+    std::string message_;
+};
+
+// AsmContext::label_scope of a pass 1 piece until it defines a non-local
+// label; the scope it inherits from the lines before it is filled in when
+// the pieces are put together
+static const uint32_t LABEL_SCOPE_INHERITED = UINT32_MAX;
+
+/**
+ * @struct AsmContext
+ * @brief Everything the assembly of one source file reads and writes.
+ *
+ * Pass 1 fills the symbol tables and the IR, branch relaxation fixes the
+ * branch sizes and addresses, and pass 2 encodes the IR and the data
+ * into the image.
+ * Nothing is shared between contexts, so different files can be assembled
+ * on different threads at the same time. Output is collected here and
+ * written out by the driver once the file is done.
+ */
+struct AsmContext
+{
+    Arena arena;          /**< Memory of the tables and the IR below; freed with the context. */
+    std::string filename; /**< The source file being assembled. */
+
+    AsmContext() = default;
+    AsmContext(const AsmContext &) = delete;
+    AsmContext &operator=(const AsmContext &) = delete;
+
+    // Pass 1 only records definitions; the tables indexed by symbol id are
+    // filled from them in definition order once pass 1 is done, so a later
+    // definition of a name wins
+    //                         symbol id  address and position
+    std::pmr::vector<std::pair<uint32_t, IrLabel>> label_defs{&arena};
+    std::pmr::vector<IrLocalLabel> local_label_defs{&arena};
+    //                         symbol id  value
+    std::pmr::vector<std::pair<uint32_t, IrSymbol>> symbol_defs{&arena};
+    std::pmr::vector<IrLabel> label_table{&arena};   /**< Non-local labels by symbol id. */
+    std::pmr::vector<IrSymbol> symbol_table{&arena}; /**< EQU values by symbol id. */
+
+    // Local labels, one small open addressing table per scope: the table
+    // of scope s is local_labels[local_label_first[s]] up to
+    // local_labels[local_label_first[s + 1]], empty if s has no local
+    // labels, else a power of two at least twice their number in size
+    std::pmr::vector<IrLocalLabel> local_labels{&arena};
+    std::pmr::vector<uint32_t> local_label_first{&arena};
+
+    /**
+     * Scope local labels are defined and looked up in: 1 + the symbol id of
+     * the last non-local label defined, or 0 before the first one.
+     */
+    uint32_t label_scope = 0;
+
+    int current_bits_mode = 16;    /**< EASM only supports 16 bit real mode, so this is a guarantee. */
+    int location_counter = 0;      /**< $ */
+    int base_location_counter = 0; /**< $$, set by the ORG directive. */
+
+    TokenStore tokens{}; /**< Tokens of the whole file; freed by the driver once the file is done. */
+    //                    token index  message
+    std::vector<std::pair<size_t, std::string>> lexer_errors; /**< Lexer errors, held back until pass 1 gets past them. */
+
+    std::pmr::vector<IrInstr> ir{&arena};      /**< Instructions collected by pass 1, in source order. */
+    std::pmr::vector<IrExpr> ir_exprs{&arena}; /**< Symbolic immediates referenced by IrInstr::expr. */
+    std::pmr::vector<IrBarrier> ir_barriers{&arena}; /**< ORG and address-dependent TIMES directives, in source order. */
+    std::pmr::vector<IrData> ir_data{&arena};  /**< Data directives, in source order. */
+
+    std::pmr::vector<uint8_t> image{&arena}; /**< Encoded instructions, indexed by address - image_base. */
+    uint32_t image_base = 0;    /**< Address of image[0]. */
+    size_t threads = 1;         /**< Threads pass 1 and pass 2 may use for this file. */
+    std::string output;         /**< File the image is written to, or empty for none. */
+    bool listing = true;        /**< Whether pass 2 lists the encoded bytes in out. */
+
+    std::ostringstream out;         /**< Text for stdout: the encoding trace and lexer errors. */
+    std::ostringstream diagnostics; /**< Text for stderr: fatal and expression errors. */
+    bool failed = false;            /**< True if the file could not be assembled completely. */
+};
+
+/**
+ * @brief Returns the index in ctx.local_labels of the slot of a local
+ * label in the table of its scope: the slot that holds the name, or the
+ * empty one where it would go. The table of the scope must not be empty.
+ */
+inline size_t local_label_slot(const AsmContext &ctx, uint32_t scope, uint32_t name)
+{
+    const uint32_t first = ctx.local_label_first[scope];
+    const uint32_t mask = ctx.local_label_first[scope + 1] - first - 1;
+    uint32_t hash = name * 0x9E3779B1u;
+    hash ^= hash >> 16;
+    // The table is at most half full, so the probe ends at an empty slot
+    for (uint32_t i = hash & mask;; i = (i + 1) & mask)
+    {
+        const IrLocalLabel &slot = ctx.local_labels[first + i];
+        if (!slot.label.defined || slot.name == name)
+            return first + i;
+    }
+}
+
+/**
+ * @brief Returns the label an IR expression refers to.
+ *
+ * A local label is looked up in the small hash table of its scope, so the
+ * time does not grow with the number of local labels in the file.
+ *
+ * @return const IrLabel* The label, or nullptr if the name is not a label.
+ */
+inline const IrLabel *find_label(const AsmContext &ctx, const IrExpr &expr)
+{
+    if (!expr.local)
+    {
+        const IrLabel &label = ctx.label_table[expr.symbol];
+        return label.defined ? &label : nullptr;
+    }
+
+    if (ctx.local_label_first[expr.scope] == ctx.local_label_first[expr.scope + 1])
+        return nullptr;
+    const IrLocalLabel &local = ctx.local_labels[local_label_slot(ctx, expr.scope, expr.symbol)];
+    return local.label.defined ? &local.label : nullptr;
+}
+
+#endif // __cplusplus
+#endif // ASM_CONTEXT_H
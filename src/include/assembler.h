@@ -0,0 +1,55 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Assembly driver: runs source files through the lexer and parser.
+
+#ifndef ASSEMBLER_H
+#define ASSEMBLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Assembles a list of source files, several at a time.
+ *
+ * Every file is assembled with its own context, so files do not see each
+ * other's labels or symbols. The files are spread over a pool of worker
+ * threads; their output and diagnostics are written in the order the
+ * files were given, each file's text in one piece.
+ *
+ * An argument of the form @name is a response file: a text file with one
+ * source file name per line. Blank lines are ignored.
+ *
+ * @param args Source file names and response files.
+ * @param count Number of entries in args.
+ * @param jobs Number of worker threads; 0 uses one per hardware thread.
+ * @param output File the flat binary image is written to, or NULL. With
+ *               several source files it is a directory (created if
+ *               missing) that gets one <name>.bin per source. Nothing is
+ *               written for a file that fails.
+ * @param listing Non-zero to print the encoded fields of every instruction.
+ * @return int 0 if every file was assembled, 1 otherwise.
+ */
+int assemble_files(const char *const *args, int count, int jobs, const char *output, int listing);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ASSEMBLER_H
@@ -0,0 +1,47 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Flat binary output.
+
+#ifndef BINARY_H
+#define BINARY_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Writes an assembled image to a file, replacing its contents.
+ *
+ * The image goes out in a single write call unless the system writes
+ * less than asked.
+ *
+ * @param path Path of the file to write.
+ * @param data The image.
+ * @param size Size of the image in bytes.
+ * @return int 0 on success, -1 on failure (errno is set).
+ */
+int binary_write(const char *path, const unsigned char *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BINARY_H
@@ -0,0 +1,414 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Pass 2 encoders, one per instruction form.
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#ifdef __cplusplus
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <utility>
+#include "asm_context.h"
+#include "ir.h"
+#include "opcode_table.h"
+#include "parser_handler.h"
+
+/**
+ * @brief Fields of an encoded instruction, as named in the listing.
+ */
+enum class Field : uint8_t
+{
+    PREFIX,
+    OPCODE,
+    REL8,
+    REL16,
+    MODRM,
+    DISP8,
+    DISP16,
+    DISP16_DIRECT,
+    IMM8,
+    IMM16
+};
+
+inline constexpr const char *field_names[] = {
+    "Segment prefix: 0x", "Opcode: 0x", "Rel8: 0x", "Rel16: 0x", "ModR/M byte: 0x", "Disp8:  0x",
+    "Disp16: 0x", "Disp16 (direct): 0x", "Immediate byte: 0x", "Immediate word: 0x"};
+
+/**
+ * @brief Appends a number in lower-case hex without leading zeros.
+ */
+inline void append_hex(std::string &text, unsigned value)
+{
+    static const char nibbles[] = "0123456789abcdef";
+    char digits[8];
+    int count = 0;
+    do
+    {
+        digits[count++] = nibbles[value & 0xF];
+        value >>= 4;
+    } while (value != 0);
+    while (count > 0)
+        text += digits[--count];
+}
+
+/**
+ * @brief Writes the bytes of one instruction into the image and, when a
+ * listing is made, lists each field from the bytes just written.
+ */
+class ByteWriter
+{
+public:
+    ByteWriter(uint8_t *dest, std::string *listing) : dest_(dest), listing_(listing) {}
+
+    void byte(Field field, uint8_t value)
+    {
+        *dest_ = value;
+        list(field, dest_[0]);
+        dest_ += 1;
+    }
+
+    void word(Field field, uint16_t value)
+    {
+        dest_[0] = static_cast<uint8_t>(value & 0xFF);
+        dest_[1] = static_cast<uint8_t>(value >> 8);
+        list(field, static_cast<unsigned>(dest_[0] | (dest_[1] << 8)));
+        dest_ += 2;
+    }
+
+private:
+    void list(Field field, unsigned value)
+    {
+        if (!listing_)
+            return;
+        *listing_ += field_names[static_cast<size_t>(field)];
+        append_hex(*listing_, value);
+        *listing_ += '\n';
+    }
+
+    uint8_t *dest_;
+    std::string *listing_;
+};
+
+/**
+ * @brief Encoder of the relative branches (JMP, Jcc, LOOP, CALL).
+ *
+ * The size chosen by branch relaxation decides the encoding: 2 bytes is
+ * the rel8 form, a 3-byte JMP is E9 rel16 and a 5-byte Jcc is the
+ * inverted condition jumping over a JMP rel16.
+ */
+inline void encode_branch(const AsmContext &ctx, const IrInstr &instr, const OpcodeInfo &info, ByteWriter out)
+{
+    const long target = instr.expr ? resolveSymbol(ctx, instr) : instr.op[0].imm;
+    const long rel = target - static_cast<long>(instr.address + instr.size);
+    const uint16_t rel16 = static_cast<uint16_t>(static_cast<unsigned long>(rel) & 0xFFFF);
+
+    if (instr.size == 2)
+    {
+        if (rel < -128 || rel > 127)
+            throw AssemblyError("Short jump out of range (line " + std::to_string(instr.line) + ")");
+        out.byte(Field::OPCODE, info.primary_opcode);
+        out.byte(Field::REL8, static_cast<uint8_t>(static_cast<unsigned long>(rel) & 0xFF));
+    }
+    else if (info.branch == BranchKind::JCC)
+    {
+        // Jcc far: J!cc +3 ; JMP rel16
+        out.byte(Field::OPCODE, static_cast<uint8_t>(info.primary_opcode ^ 1));
+        out.byte(Field::REL8, 3);
+        out.byte(Field::OPCODE, 0xE9);
+        out.word(Field::REL16, rel16);
+    }
+    else
+    {
+        // JMP near (E9) or CALL (E8)
+        out.byte(Field::OPCODE, info.branch == BranchKind::JMP ? 0xE9 : info.primary_opcode);
+        out.word(Field::REL16, rel16);
+    }
+}
+
+/**
+ * @brief Writes the displacement of a memory operand, as its mod and r/m fields ask.
+ */
+inline void encode_disp(const AsmContext &ctx, const IrInstr &instr, const IrOperand &m, ByteWriter &out)
+{
+    const uint8_t mod = static_cast<uint8_t>(m.reg >> 6);
+    long disp = m.disp;
+    if (instr.expr && ctx.ir_exprs[instr.expr - 1].address)
+        disp += resolveSymbol(ctx, instr);
+    const uint16_t disp16 = static_cast<uint16_t>(static_cast<unsigned long>(disp) & 0xFFFF);
+    if (mod == 0b01)
+        out.byte(Field::DISP8, static_cast<uint8_t>(disp16 & 0xFF));
+    else if (mod == 0b10)
+        out.word(Field::DISP16, disp16);
+    else if (mod == 0b00 && (m.reg & 7) == 0b110)
+        out.word(Field::DISP16_DIRECT, disp16); // direct [disp16] addressing (mod=00, r/m=110)
+}
+
+/**
+ * @brief Encoder of the instructions whose operands have the types Op1 and Op2.
+ *
+ * Which operand goes into the r/m field and what fills the reg field
+ * follows from the operand types alone, so it is decided at compile
+ * time; only the opcode details are read from the form.
+ */
+template <OperandType Op1, OperandType Op2>
+void encode_form(const AsmContext &ctx, const IrInstr &instr, const OpcodeInfo &info, ByteWriter out)
+{
+    constexpr bool reg_reg = is_register(Op1) && Op2 == Op1;         // r <- r: source in reg, dest in r/m
+    constexpr bool reg_mem = is_register(Op1) && is_memory(Op2);      // r <- m
+    constexpr bool mem_reg = is_memory(Op1) && is_register(Op2);      // m <- r
+    constexpr bool rm_imm = (is_register(Op1) || is_memory(Op1)) && is_immediate(Op2); // group opcode, ext in reg
+    constexpr size_t rm_index = reg_mem ? 1 : 0;
+
+    if constexpr (is_memory(Op1) || is_memory(Op2))
+    {
+        if (instr.prefix)
+            out.byte(Field::PREFIX, instr.prefix);
+    }
+    // Without a ModR/M byte a general register is added to the opcode (B8+rw)
+    constexpr bool reg_in_opcode = Op1 == OperandType::REG8 || Op1 == OperandType::REG16;
+    if (reg_in_opcode && !info.requires_modrm)
+        out.byte(Field::OPCODE, static_cast<uint8_t>(info.primary_opcode + (instr.op[0].reg & 7)));
+    else
+        out.byte(Field::OPCODE, info.primary_opcode);
+
+    if (info.requires_modrm)
+    {
+        if constexpr (is_memory(Op1) && is_memory(Op2))
+        {
+            throw AssemblyError("Memory-to-memory operation not encodable (use a register).");
+        }
+        else if constexpr (reg_reg || reg_mem || mem_reg || rm_imm)
+        {
+            const IrOperand &rm = instr.op[rm_index];
+            const uint8_t reg = rm_imm ? info.opcode_ext : instr.op[1 - rm_index].reg;
+            if constexpr (is_memory(rm_index ? Op2 : Op1))
+            {
+                out.byte(Field::MODRM, static_cast<uint8_t>((rm.reg & 0xC7) | ((reg & 7) << 3)));
+                encode_disp(ctx, instr, rm, out);
+            }
+            else
+            {
+                out.byte(Field::MODRM, static_cast<uint8_t>(0xC0 | ((reg & 7) << 3) | (rm.reg & 7)));
+            }
+        }
+        else
+        {
+            throw AssemblyError("Unhandled ModR/M combination.");
+        }
+    }
+
+    // Pass 1 made sure there is an immediate if the form has one
+    if (info.has_imm)
+    {
+        const IrOperand &immOp = instr.op[is_immediate(Op2) ? 1 : 0];
+        const bool symbolic = instr.expr && !ctx.ir_exprs[instr.expr - 1].address;
+        const unsigned long value = static_cast<unsigned long>(symbolic ? resolveSymbol(ctx, instr) : immOp.imm);
+        if (info.imm_size == 1)
+            out.byte(Field::IMM8, static_cast<uint8_t>(value & 0xFF));
+        else
+            out.word(Field::IMM16, static_cast<uint16_t>(value & 0xFFFF));
+    }
+}
+
+/**
+ * @brief encode_form() of every pair of operand types, indexed by op1 * OPERAND_TYPE_COUNT + op2.
+ */
+template <size_t... I>
+constexpr std::array<FormEncoder, sizeof...(I)> make_form_encoders(std::index_sequence<I...>)
+{
+    return {{&encode_form<static_cast<OperandType>(I / OPERAND_TYPE_COUNT),
+                          static_cast<OperandType>(I % OPERAND_TYPE_COUNT)>...}};
+}
+
+/**
+ * @brief Picks the encoder of an instruction form; used by OpcodeTable::bind_encoders().
+ */
+constexpr FormEncoder form_encoder(OperandType op1, OperandType op2, const OpcodeInfo &info)
+{
+    constexpr std::array<FormEncoder, OPERAND_TYPE_COUNT * OPERAND_TYPE_COUNT> encoders =
+        make_form_encoders(std::make_index_sequence<OPERAND_TYPE_COUNT * OPERAND_TYPE_COUNT>());
+    if (info.branch != BranchKind::NONE)
+        return &encode_branch;
+    return encoders[static_cast<size_t>(op1) * OPERAND_TYPE_COUNT + static_cast<size_t>(op2)];
+}
+
+/**
+ * @class EncodeCache
+ * @brief Finished encodings of recently seen instructions, for one encode chunk.
+ *
+ * An instruction without a label reference that is not a relative branch
+ * encodes to the same bytes and listing lines at any address. The cache
+ * maps the IR fields that decide the encoding (mnemonic, prefix, form and
+ * the packed operands, immediates included) to those results, so a
+ * repeated instruction is copied instead of encoded. It is a small open
+ * addressing table that never grows: when the probe window of a key is
+ * full, its home slot is overwritten.
+ *
+ * A miss costs more than encoding the instruction directly, so a chunk
+ * whose instructions rarely repeat turns the cache off: after every
+ * WINDOW lookups, fewer than one hit in eight disables it.
+ */
+class EncodeCache
+{
+public:
+    static constexpr size_t SLOTS = 512;       /**< Number of entries; a power of two. */
+    static constexpr size_t PROBES = 4;        /**< Slots looked at from the home slot of a key. */
+    static constexpr size_t MAX_BYTES = 8;     /**< Longest cached encoding. */
+    static constexpr size_t MAX_LISTING = 112; /**< Longest cached listing text. */
+    static constexpr unsigned long long WINDOW = 4096; /**< Lookups between two hit rate checks. */
+
+    EncodeCache() : entries_{} {}
+
+    /**
+     * @brief Returns false once the hit rate was too low to be worth the lookups.
+     */
+    bool enabled() const
+    {
+        return enabled_;
+    }
+
+    /**
+     * @brief Copies the cached encoding of an instruction, if there is one.
+     *
+     * @param instr An instruction without a label reference (expr is 0).
+     * @param dest Receives instr.size bytes on a hit.
+     * @param listing Receives the listing lines on a hit, or nullptr for no listing.
+     * @return bool True on a hit.
+     */
+    bool find(const IrInstr &instr, uint8_t *dest, std::string *listing)
+    {
+        if (++lookups % WINDOW == 0)
+        {
+            enabled_ = hits - window_hits_ >= WINDOW / 8;
+            window_hits_ = hits;
+        }
+        const Key key = make_key(instr);
+        const size_t home = slot_of(key);
+        for (size_t p = 0; p < PROBES; p++)
+        {
+            const size_t at = (home + p) & (SLOTS - 1);
+            const Entry &entry = entries_[at];
+            if (entry.key.head == 0)
+                return false;
+            if (entry.key == key)
+            {
+                hits++;
+                std::memcpy(dest, entry.bytes, entry.size);
+                if (listing)
+                    listing->append(listings_[at], entry.listing_size);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Remembers the encoding just written for an instruction that find() missed.
+     *
+     * Relative branches and encodings too long for an entry are not cached.
+     *
+     * @param instr The instruction (expr is 0).
+     * @param bytes Its instr.size encoded bytes.
+     * @param listing Its listing lines; empty when there is no listing.
+     */
+    void store(const IrInstr &instr, const uint8_t *bytes, std::string_view listing)
+    {
+        if (instr.size > MAX_BYTES || listing.size() > MAX_LISTING ||
+            opcode_table.form(instr.form).branch != BranchKind::NONE)
+            return;
+        const Key key = make_key(instr);
+        const size_t home = slot_of(key);
+        size_t at = home;
+        for (size_t p = 0; p < PROBES; p++)
+        {
+            const size_t probe = (home + p) & (SLOTS - 1);
+            if (entries_[probe].key.head == 0)
+            {
+                at = probe;
+                break;
+            }
+        }
+        Entry &entry = entries_[at];
+        entry.key = key;
+        entry.size = instr.size;
+        entry.listing_size = static_cast<uint8_t>(listing.size());
+        std::memcpy(entry.bytes, bytes, instr.size);
+        if (!listing.empty())
+            std::memcpy(listings_[at], listing.data(), listing.size());
+    }
+
+    unsigned long long lookups = 0; /**< Calls to find(). */
+    unsigned long long hits = 0;    /**< Calls to find() that found the instruction. */
+
+private:
+    /**
+     * @brief The IR fields that decide the encoding; head is never 0 for a real key.
+     */
+    struct Key
+    {
+        uint64_t op0;  /**< First IrOperand, bit for bit. */
+        uint64_t op1;  /**< Second IrOperand, bit for bit. */
+        uint32_t head; /**< Mnemonic, prefix and form, and bit 24 set. */
+
+        bool operator==(const Key &other) const
+        {
+            return op0 == other.op0 && op1 == other.op1 && head == other.head;
+        }
+    };
+
+    struct Entry
+    {
+        Key key;
+        uint8_t size;
+        uint8_t listing_size;
+        uint8_t bytes[MAX_BYTES];
+    };
+
+    static Key make_key(const IrInstr &instr)
+    {
+        static_assert(sizeof(IrOperand) == sizeof(uint64_t), "IrOperand is packed into a key word");
+        Key key;
+        std::memcpy(&key.op0, &instr.op[0], sizeof(key.op0));
+        std::memcpy(&key.op1, &instr.op[1], sizeof(key.op1));
+        key.head = static_cast<uint32_t>(instr.mnemonic) | static_cast<uint32_t>(instr.prefix) << 8 |
+                   static_cast<uint32_t>(instr.form) << 16 | 1u << 24;
+        return key;
+    }
+
+    static size_t slot_of(const Key &key)
+    {
+        uint64_t h = key.op0 * 0x9E3779B97F4A7C15ull;
+        h ^= key.op1 * 0xC2B2AE3D27D4EB4Full;
+        h ^= key.head * 0x165667B19E3779F9ull;
+        return static_cast<size_t>(h >> 40) & (SLOTS - 1);
+    }
+
+    Entry entries_[SLOTS];
+    char listings_[SLOTS][MAX_LISTING];
+    unsigned long long window_hits_ = 0; /**< hits at the start of the current window. */
+    bool enabled_ = true;
+};
+
+#endif // __cplusplus
+#endif // ENCODER_H
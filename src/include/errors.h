@@ -65,6 +65,11 @@ static const char* const ERROR_NO_CHAR_WRITTEN_AND_END_OF_LINE = "Error: Char is
  */
 static const char* const ERROR_UNKNOWN_TOKEN = "Error: Cannot resolve symbol.";
 
+/**
+ * @brief Error message for a malformed numeric literal such as 0x0x1 or 19b.
+ */
+static const char* const ERROR_INVALID_NUMBER = "Error: Invalid numeric literal.";
+
 #ifdef __cplusplus
 }
 #endif // __cplusplus
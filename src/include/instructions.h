@@ -21,6 +21,10 @@
 
 #include <stdlib.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @enum InstructionType
  * @brief Enumeration of supported assembly instruction types and directives.
@@ -134,142 +138,16 @@ typedef enum
     DIRECTIVE_EXTERN,  /**< EXTERN directive */
     DIRECTIVE_GLOBAL,  /**< GLOBAL directive */
     DIRECTIVE_ALIGN,   /**< ALIGN directive */
-    DIRECTIVE_TIMES    /**< TIMES directive */
-
-} InstructionType;
-
-/**
- * @struct InstructionEntry
- * @brief Maps instruction mnemonic strings to their corresponding instruction or directive type.
- */
-typedef struct
-{
-    const char *mnemonic; /**< Instruction or directive mnemonic (uppercase) */
-    InstructionType type; /**< Corresponding instruction or directive type */
-} InstructionEntry;
+    DIRECTIVE_TIMES,   /**< TIMES directive */
 
-/**
- * @brief Instruction and directive lookup table.
- *
- * Contains all supported instruction mnemonics and assembler directives.
- * The last entry is a sentinel with NULL mnemonic.
- */
-static const InstructionEntry instruction_table[] = {
-    // Instructions
-    {"MOV", INSTR_MOV},
-    {"HLT", INSTR_HLT},
-    {"INT", INSTR_INT},
-    {"PUSH", INSTR_PUSH},
-    {"POP", INSTR_POP},
-    {"LEA", INSTR_LEA},
-    {"ADD", INSTR_ADD},
-    {"SUB", INSTR_SUB},
-    {"INC", INSTR_INC},
-    {"DEC", INSTR_DEC},
-    {"IMUL", INSTR_IMUL},
-    {"IDIV", INSTR_IDIV},
-    {"AND", INSTR_AND},
-    {"OR", INSTR_OR},
-    {"XOR", INSTR_XOR},
-    {"NOT", INSTR_NOT},
-    {"NEG", INSTR_NEG},
-    {"SHL", INSTR_SHL},
-    {"SAL", INSTR_SAL},
-    {"SHR", INSTR_SHR},
-    {"SAR", INSTR_SAR},
-    {"JMP", INSTR_JMP},
-    {"JE", INSTR_JE},
-    {"JNE", INSTR_JNE},
-    {"JZ", INSTR_JZ},
-    {"JNZ", INSTR_JNZ},
-    {"JG", INSTR_JG},
-    {"JGE", INSTR_JGE},
-    {"JL", INSTR_JL},
-    {"JLE", INSTR_JLE},
-    {"JA", INSTR_JA},
-    {"JAE", INSTR_JAE},
-    {"JB", INSTR_JB},
-    {"JBE", INSTR_JBE},
-    {"CALL", INSTR_CALL},
-    {"RET", INSTR_RET},
-    {"SET", INSTR_SET},
-    {"TEST", INSTR_TEST},
-    {"JS", INSTR_JS},
-    {"JNS", INSTR_JNS},
-    {"CMP", INSTR_CMP},
-    {"XCHG", INSTR_XCHG},
-    {"LOCK", INSTR_LOCK},
-    {"LEAVE", INSTR_LEAVE},
-    {"NOP", INSTR_NOP},
-    {"MOVSX", INSTR_MOVSX},
-    {"MOVZX", INSTR_MOVZX},
-    {"BOUND", INSTR_BOUND},
-    {"WAIT", INSTR_WAIT},
-    {"LODS", INSTR_LODS},
-    {"STOS", INSTR_STOS},
-    {"SCAS", INSTR_SCAS},
-    {"CMPS", INSTR_CMPS},
-    {"REP", INSTR_REP},
-    {"REPE", INSTR_REPE},
-    {"REPNE", INSTR_REPNE},
-    {"SALC", INSTR_SALC},
-    {"ARPL", INSTR_ARPL},
-    {"CLD", INSTR_CLD},
-    {"STD", INSTR_STD},
-    {"CLC", INSTR_CLC},
-    {"STC", INSTR_STC},
-    {"CMC", INSTR_CMC},
-    {"ESC", INSTR_ESC},
-    {"IN", INSTR_IN},
-    {"OUT", INSTR_OUT},
-    {"INT3", INSTR_INT3},
-    {"IRET", INSTR_IRET},
-    {"SYSCALL", INSTR_SYSCALL},
-    {"SYSRET", INSTR_SYSRET},
-    {"CLI", INSTR_CLI},
-    {"LOOP", INSTR_LOOP},
-    {"LODSB", INSTR_LODSB},
-    {"LODSW", INSTR_LODSW},
-    {"LODSD", INSTR_LODSD},
-    {"LODSQ", INSTR_LODSQ},
-    {"PUSHA", INSTR_PUSHA},
-    {"POPA", INSTR_POPA},
-
-    // System control instructions
-    {"LGDT", INSTR_LGDT},
-    {"SGDT", INSTR_SGDT},
-    {"LIDT", INSTR_LIDT},
-    {"SIDT", INSTR_SIDT},
-    {"LTR", INSTR_LTR},
-    {"STR", INSTR_STR},
-    {"MOVCR", INSTR_MOVCR},
-    {"CLTS", INSTR_CLTS},
-    {"INVLPG", INSTR_INVLPG},
-    {"VERR", INSTR_VERR},
-    {"VERW", INSTR_VERW},
+    INSTRUCTION_TYPE_COUNT /**< Number of instruction types (not an instruction) */
 
-    // Directives
-    {"ORG", DIRECTIVE_ORG},
-    {"BITS", DIRECTIVE_BITS},
-    {"DB", DIRECTIVE_DB},
-    {"DW", DIRECTIVE_DW},
-    {"DD", DIRECTIVE_DD},
-    // {"DQ", DIRECTIVE_DQ},
-    // {"DT", DIRECTIVE_DT},
-    {"EQU", DIRECTIVE_EQU},
-    // {"SECTION", DIRECTIVE_SECTION},
-    // {"EXTERN", DIRECTIVE_EXTERN},
-    // {"GLOBAL", DIRECTIVE_GLOBAL},
-    {"ALIGN", DIRECTIVE_ALIGN},
-    {"TIMES", DIRECTIVE_TIMES},
-
-    {NULL, INSTR_GENERIC} /**< Sentinel marking end of table */
-};
+} InstructionType;
 
 /**
  * @brief Retrieves the instruction or directive type for a given mnemonic.
  *
- * This function performs a case-insensitive lookup in the instruction table.
+ * The mnemonic is found in the keyword table (see keyword_find()).
  *
  * @param lexeme The instruction or directive mnemonic to lookup (case-insensitive).
  * @return The corresponding InstructionType or INSTR_GENERIC if not found.
@@ -289,4 +167,8 @@ InstructionType get_instruction_type(const char *lexeme);
  */
 const char *instruction_type_to_string(InstructionType type);
 
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
 #endif // INSTRUCTIONS_H
@@ -0,0 +1,101 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Interning of identifiers into dense symbol ids.
+
+#ifndef INTERNER_H
+#define INTERNER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Returned by interner_intern() when memory runs out and by
+ * interner_find() for an unknown name.
+ */
+#define INTERNER_NO_ID UINT32_MAX
+
+/**
+ * @brief Maps each distinct identifier of a source file to a 32-bit id.
+ *
+ * Ids are handed out as 0, 1, 2, ... in the order the names are first
+ * seen, so tables indexed by id can be flat arrays. Names are not copied:
+ * id i names the length[i] bytes at source + offsets[i]. Lookups hash
+ * the name once and probe an open-addressing table; only growing the
+ * arrays allocates.
+ */
+typedef struct
+{
+    const char *source; /**< Text the names point into */
+    uint32_t *offsets;  /**< Start of the name of each id in source */
+    uint32_t *lengths;  /**< Length of the name of each id */
+    uint32_t *hashes;   /**< Hash of the name of each id, kept for growing the table */
+    uint32_t count;     /**< Number of ids handed out */
+    uint32_t capacity;  /**< Number of ids the arrays have room for */
+    uint32_t *slots;    /**< Hash table of id + 1, 0 for a free slot; at most half full */
+    uint32_t slot_mask; /**< Number of slots minus one (a power of two minus one) */
+} Interner;
+
+/**
+ * @brief Prepares an empty interner for the names of a source text.
+ *
+ * @param interner The interner to initialize.
+ * @param source The text all names will point into.
+ */
+void interner_init(Interner *interner, const char *source);
+
+/**
+ * @brief Returns the id of a name, giving it the next free id if it is new.
+ *
+ * Names are compared byte for byte, so labels are case-sensitive.
+ *
+ * @param interner The interner.
+ * @param name The name; it must point into the source of the interner.
+ * @param length Length of the name in bytes.
+ * @return uint32_t The id, or INTERNER_NO_ID if memory ran out.
+ */
+uint32_t interner_intern(Interner *interner, const char *name, uint32_t length);
+
+/**
+ * @brief Returns the id of a name without adding it.
+ *
+ * Does not modify the interner, so several threads may look names up at
+ * once while no one interns.
+ *
+ * @param interner The interner.
+ * @param name The name to look up; it may point anywhere.
+ * @param length Length of the name in bytes.
+ * @return uint32_t The id, or INTERNER_NO_ID if the name was never interned.
+ */
+uint32_t interner_find(const Interner *interner, const char *name, uint32_t length);
+
+/**
+ * @brief Frees the arrays of an interner and leaves it empty.
+ *
+ * @param interner The interner to release.
+ */
+void interner_free(Interner *interner);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // INTERNER_H
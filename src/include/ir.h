@@ -0,0 +1,149 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Intermediate representation passed from pass 1 to pass 2.
+
+#ifndef IR_H
+#define IR_H
+
+#ifdef __cplusplus
+#include <cstdint>
+#include <string_view>
+#include "opcode_table.h"
+
+/**
+ * @struct IrOperand
+ * @brief One operand of an IR instruction, packed into 8 bytes.
+ */
+struct IrOperand
+{
+    OperandType type; /**< Kind of the operand (NONE if absent). */
+    uint8_t reg;      /**< Register code for REG8/REG16, segment code for SEGREG, ModR/M mod and r/m fields for MEM8/MEM16. */
+    int16_t disp;     /**< Displacement of a memory operand, added to its label if it has one. */
+    int32_t imm;      /**< Value of an immediate operand that is a plain number. */
+};
+
+/**
+ * @struct IrInstr
+ * @brief One instruction after pass 1, ready to be encoded.
+ *
+ * Pass 1 has already picked the opcode form, computed the size and
+ * assigned the address, so pass 2 works from these 32-byte records
+ * alone and never looks at the source text again.
+ */
+struct IrInstr
+{
+    uint32_t address;   /**< Address of the first byte of the instruction. */
+    uint32_t line;      /**< Source line, for diagnostics. */
+    uint32_t expr;      /**< 1-based index into AsmContext::ir_exprs of a symbolic immediate or displacement, 0 if none. */
+    uint8_t mnemonic;   /**< InstructionType of the mnemonic. */
+    uint8_t prefix;     /**< Segment override prefix byte, 0 if none. */
+    uint8_t form;       /**< Opcode form id from OpcodeTable::find_form(). */
+    uint8_t size;       /**< Encoded size in bytes. */
+    IrOperand op[2];    /**< Operands; op[1].type is NONE for one-operand forms. */
+};
+
+static_assert(sizeof(IrInstr) == 32, "IrInstr should stay two per cache line");
+
+/**
+ * @struct IrLabel
+ * @brief A label and where it sits in the instruction stream.
+ *
+ * The anchor lets branch relaxation move the label when an instruction
+ * before it grows.
+ */
+struct IrLabel
+{
+    int32_t address;      /**< Address of the label. */
+    uint32_t anchor;      /**< Number of IR instructions defined before the label. */
+    uint32_t barrier;     /**< Number of IR barriers defined before the label. */
+    bool defined = false; /**< False for the entries of names that are not labels. */
+};
+
+/**
+ * @struct IrLocalLabel
+ * @brief A local label (.name) and the non-local label it belongs to.
+ */
+struct IrLocalLabel
+{
+    uint32_t scope; /**< Scope of the label; see AsmContext::label_scope. */
+    uint32_t name;  /**< Symbol id of the name, without the dot. */
+    IrLabel label;  /**< Where the label is. */
+};
+
+/**
+ * @struct IrSymbol
+ * @brief The value an EQU gave a name.
+ */
+struct IrSymbol
+{
+    bool defined = false; /**< False for the entries of names that were never given a value. */
+    long value = 0;       /**< The number the EQU gave the name, as the lexer parsed it. */
+    uint32_t alias = 0;   /**< 1 + symbol id of the name the EQU refers to (X equ Y), or 0 for a number. */
+};
+
+/**
+ * @struct IrBarrier
+ * @brief A directive that decides the address after it by itself.
+ *
+ * ORG sets an absolute address. TIMES with a $ in its count pads up to
+ * an address; when code before it grows, the padding shrinks. Address
+ * changes before a barrier are recomputed at the barrier instead of
+ * being passed through unchanged.
+ */
+struct IrBarrier
+{
+    uint32_t ir_index;     /**< Number of IR instructions defined before the directive. */
+    int32_t start;         /**< $ at the directive in pass 1. */
+    int32_t end;           /**< Location counter after the directive in pass 1. */
+    int32_t base;          /**< $$ at the directive. */
+    int32_t unit;          /**< Bytes per TIMES repetition; 0 for ORG. */
+    std::string_view expr; /**< TIMES repeat count expression, kept in the arena; empty for ORG. */
+};
+
+/**
+ * @struct IrData
+ * @brief The bytes a DB, DW, DD or TIMES directive puts into the image.
+ *
+ * Anchored in the instruction stream like a label, so that branch
+ * relaxation can move it.
+ */
+struct IrData
+{
+    int32_t address;        /**< Address of the first byte. */
+    uint32_t anchor;        /**< Number of IR instructions defined before the data. */
+    uint32_t barrier;       /**< Number of IR barriers defined before the data. */
+    uint32_t count;         /**< Number of times the bytes are repeated. */
+    std::string_view bytes; /**< One repetition, kept in the arena. */
+    bool padding;           /**< TIMES with $ in its count: ir_barriers[barrier] decides the count. */
+};
+
+/**
+ * @struct IrExpr
+ * @brief An immediate or displacement whose value is only known after pass 1.
+ */
+struct IrExpr
+{
+    uint32_t symbol; /**< Symbol id of the label or EQU name the immediate refers to. */
+    uint32_t scope;  /**< Scope of a local label reference (.name); see AsmContext::label_scope. */
+    bool local;      /**< True for a local label reference. */
+    bool address;    /**< True if the symbol is the displacement of the memory operand, not the immediate. */
+};
+
+#endif // __cplusplus
+#endif // IR_H
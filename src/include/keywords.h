@@ -0,0 +1,57 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Keyword recognition: mnemonics, directives, registers and section names.
+
+#ifndef KEYWORDS_H
+#define KEYWORDS_H
+
+#include "lexer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief What an identifier means when it is a keyword.
+ */
+typedef struct
+{
+    TokenType type;             /**< TOKEN_INSTR, TOKEN_REG8, TOKEN_REG16, TOKEN_SEGREG, TOKEN_SECTION or TOKEN_SECTION_TYPE */
+    InstructionType instr_type; /**< Mnemonic or directive of a TOKEN_INSTR keyword, INSTR_GENERIC otherwise */
+    int reg;                    /**< Register8, Register16 or SegmentRegister value of a register keyword */
+} Keyword;
+
+/**
+ * @brief Looks up an identifier among the keywords, ignoring case.
+ *
+ * The identifier is packed into a 64-bit key with its letters folded to
+ * upper case, which does not depend on the locale, and the key is found
+ * with a single probe of a perfect hash table built at compile time.
+ *
+ * @param text The identifier; only letters, digits, '_' and '.' are expected.
+ * @param length Length of the identifier in bytes.
+ * @return const Keyword* The keyword, or NULL if the identifier is not one.
+ */
+const Keyword *keyword_find(const char *text, int length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // KEYWORDS_H
@@ -19,9 +19,14 @@
 #ifndef LEXER_H
 #define LEXER_H
 
+#include <stddef.h>
 #include "registers.h"
 #include "instructions.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Represents different types of tokens that can be identified during lexical analysis.
  */
@@ -73,6 +78,10 @@ typedef enum {
 
 /**
  * @brief Structure representing a token returned by the lexer.
+ *
+ * Tokens are handed to the parser by pointer, so the parser reads the
+ * kind, ids and numeric value directly instead of re-parsing text.
+ * The lexeme is a view into the source text and is not NUL-terminated.
  */
 typedef struct
 {
@@ -82,51 +91,97 @@ typedef struct
     Register16 t_register16; /**< Type of the register (16 bit) */
     // Register32 t_register32; /**< Type of the register (32 bit) */
     SegmentRegister t_segregister; /**< Type of the register (segment register) */
+    long value;             /**< Value of a TOKEN_NUMBER, or of a TOKEN_STRING of up to 8 bytes read as a character constant (0 otherwise) */
+    unsigned int symbol;    /**< Symbol id of a TOKEN_LABEL or plain identifier, given by the token store (0 before that) */
     int line;               /**< Line number where the token was found */
-    char lexeme[64];        /**< The actual lexeme (string representation) */
+    const char *lexeme;     /**< Start of the lexeme in the source (string literals: text between the quotes) */
+    int length;             /**< Length of the lexeme in bytes */
 } Token;
 
 /**
- * @brief Retrieves the next token from the input stream.
- * 
- * @param input_ptr Pointer to the input character stream.
- * @param line Pointer to the current line number.
- * @return Token The next identified token.
+ * @brief Callback that receives the non-fatal diagnostics of a lexer.
+ *
+ * @param data The report_data pointer of the lexer.
+ * @param error_name A descriptive error message.
+ * @param line The line the error was found on.
+ * @param file The name of the file being lexed.
  */
-Token get_next_token(const char **input_ptr, int *line);
+typedef void (*LexerReport)(void *data, const char *error_name, int line, const char *file);
 
 /**
- * @brief Processes a line of code using the lexer and prints tokens.
- * 
- * @param line The line of code to process.
- * @param file The name of the file being parsed.
- * @param line_number_ptr Pointer to the current line number.
+ * @brief The state of one lexer.
+ *
+ * Every source file gets its own lexer, so several files can be
+ * tokenized at the same time on different threads.
+ */
+typedef struct
+{
+    const char *cursor;    /**< Next character to scan */
+    const char *end;       /**< End of the source (points at its NUL byte) */
+    int line;              /**< Current line number */
+    int line_has_tokens;   /**< Non-zero if the current line produced a token */
+    const char *filename;  /**< The file name for error reporting */
+    LexerReport report;    /**< Receives diagnostics; NULL prints them with occur_error() */
+    void *report_data;     /**< Passed to report */
+} Lexer;
+
+/**
+ * @brief Prepares a lexer for a whole source buffer or a run of its lines.
+ *
+ * No token reaches past a '\n', so a part of a buffer that ends just
+ * after a newline can be lexed on its own; line numbers then count from
+ * 1 at the start of the part.
+ *
+ * @param lexer The lexer to initialize.
+ * @param source The text. source[size] must be a NUL byte, or source[size - 1] a '\n'.
+ * @param size Size of the contents in bytes.
+ * @param file The name of the file being lexed.
  */
-void lexer_process_line(const char *line, const char *file, int *line_number_ptr);
+void lexer_init(Lexer *lexer, const char *source, size_t size, const char *file);
 
 /**
- * @brief Converts a TokenType to its corresponding string representation.
+ * @brief Scans the next token at the cursor of the lexer.
  * 
- * @param type The token type.
- * @return const char* String representation of the token type.
+ * The returned lexeme points into the input and is valid as long as the input is.
+ * Line numbers are not advanced here; see lexer_next().
+ * 
+ * @param lexer The lexer to read from.
+ * @return Token The next identified token.
  */
-const char *token_type_to_string(TokenType type);
+Token get_next_token(Lexer *lexer);
 
 /**
- * @brief Checks if a given position is inside quotation marks.
+ * @brief Returns the next token of the source, keeping track of lines.
  * 
- * @param line_start Pointer to the start of the line.
- * @param pos Pointer to the character position to check.
- * @return int 1 if inside quotes, 0 otherwise.
+ * Every line ends with a TOKEN_EOL, including a last line without a
+ * trailing newline. After the input is exhausted TOKEN_EOF is returned.
+ * Lines and lexemes have no length limit.
+ * 
+ * @param lexer The lexer to read from.
+ * @return Token The next token.
+ */
+Token lexer_next(Lexer *lexer);
+
+/**
+ * @brief Parses a NASM numeric literal.
+ *
+ * Accepts decimal (42, 42d), hex (0x2A, 0h2A, 2Ah), binary (0b101010,
+ * 101010b, 0y, y), octal (0o52, 52o, 0q, 52q) and '_' digit separators.
+ *
+ * @param text The literal; it does not need to be NUL-terminated.
+ * @param length Length of the literal in bytes.
+ * @param value Receives the value.
+ * @return int 0 on success, -1 if the text is not a valid literal or does not fit in 64 bits.
  */
-int is_inside_quotes(const char *line_start, const char *pos);
+int lexer_parse_number(const char *text, int length, long *value);
 
 /**
- * @brief Sets the current filename for context in error reporting.
+ * @brief Converts a TokenType to its corresponding string representation.
  * 
- * @param filename The filename to set.
+ * @param type The token type.
+ * @return const char* String representation of the token type.
  */
-void set_filename(const char *filename);
+const char *token_type_to_string(TokenType type);
 
 /**
  * @brief Determines the token type based on a register's name.
@@ -168,4 +223,8 @@ int is_register8(const char *lexeme);
  */
 int is_segment_register(const char *lexeme);
 
+#ifdef __cplusplus
+}
+#endif // __cplusplus
+
 #endif // LEXER_H
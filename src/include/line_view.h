@@ -0,0 +1,125 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Non-owning views over the tokens of one source line.
+
+#ifndef LINE_VIEW_H
+#define LINE_VIEW_H
+
+#ifdef __cplusplus
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include "lexer.h"
+#include "token_store.h"
+
+/**
+ * @brief Returns the lexeme of a token as a view into the source text.
+ *
+ * @param token The token.
+ * @return std::string_view The lexeme; no copy is made.
+ */
+inline std::string_view token_text(const Token &token)
+{
+    return std::string_view(token.lexeme, static_cast<size_t>(token.length));
+}
+
+/**
+ * @brief Returns the name of a symbol id as a view into the source text.
+ *
+ * @param store The token store that gave out the id.
+ * @param symbol The symbol id of a label or plain identifier.
+ * @return std::string_view The name; no copy is made.
+ */
+inline std::string_view symbol_name(const TokenStore &store, uint32_t symbol)
+{
+    const Interner &names = store.symbols;
+    return std::string_view(names.source + names.offsets[symbol], names.lengths[symbol]);
+}
+
+/**
+ * @struct LineView
+ * @brief A non-owning view of the tokens of one source line.
+ *
+ * The tokens live in the token store of the file and their lexemes point
+ * into the source buffer, so a line can be parsed and encoded without
+ * copying or allocating anything. The last token of a line is always
+ * TOKEN_EOL.
+ */
+struct LineView
+{
+    const TokenStore *store; /**< Tokens of the file. */
+    size_t first;            /**< Index of the first token of the line in the store. */
+    size_t count;            /**< Number of tokens, including the final TOKEN_EOL. */
+    int line;                /**< Source line number. */
+
+    size_t size() const { return count; }
+
+    /**
+     * @brief Puts token i of the line back together from the arrays of the store.
+     *
+     * Inlined, so only the fields a caller reads are loaded.
+     */
+    Token operator[](size_t i) const
+    {
+        const size_t at = first + i;
+        Token token;
+        token.type = static_cast<TokenType>(store->kinds[at]);
+        token.instr_type = INSTR_GENERIC;
+        token.t_register8 = REG8_NONE;
+        token.t_register16 = REG16_NONE;
+        token.t_segregister = SEGREG_NONE;
+        token.value = 0;
+        token.symbol = 0;
+        const int32_t payload = store->payloads[at];
+        switch (token.type)
+        {
+        case TOKEN_INSTR:
+            if (payload < 0)
+                token.symbol = ~static_cast<uint32_t>(payload); // plain identifier
+            else
+                token.instr_type = static_cast<InstructionType>(payload);
+            break;
+        case TOKEN_LABEL:
+            token.symbol = static_cast<uint32_t>(payload);
+            break;
+        case TOKEN_REG8:
+            token.t_register8 = static_cast<Register8>(payload);
+            break;
+        case TOKEN_REG16:
+            token.t_register16 = static_cast<Register16>(payload);
+            break;
+        case TOKEN_SEGREG:
+            token.t_segregister = static_cast<SegmentRegister>(payload);
+            break;
+        case TOKEN_NUMBER:
+        case TOKEN_STRING:
+            token.value = payload;
+            break;
+        default:
+            break;
+        }
+        token.line = line;
+        token.lexeme = store->source + store->offsets[at];
+        token.length = static_cast<int>(store->lengths[at]);
+        return token;
+    }
+};
+
+#endif // __cplusplus
+#endif // LINE_VIEW_H
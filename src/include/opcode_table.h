@@ -21,9 +21,11 @@
 
 #ifdef __cplusplus
 #include <string>
-#include <unordered_map>
 #include <stdint.h>
-#include <vector>
+#include <stddef.h>
+#include <string_view>
+#include "instructions.h"
+#include "line_view.h"
 
 /**
  * @enum OperandType
@@ -32,7 +34,7 @@
  * This enumeration specifies the size and kind of operand used by an instruction.
  * It can be an immediate value, a register, a memory reference, or none at all.
  */
-enum class OperandType {
+enum class OperandType : uint8_t {
     NONE,   /**< No operand. */
     IMM8,   /**< Immediate value (8-bit). */
     IMM16,  /**< Immediate value (16-bit). */
@@ -45,7 +47,40 @@ enum class OperandType {
     // MEM32,  /**< Memory operand (32-bit). */
     SEGREG,  /**< Segment register. */
     STRING, /**< String expression */
-    CHAR
+    CHAR,
+    COUNT   /**< Number of operand types (not an operand type). */
+};
+
+/**
+ * @brief Number of distinct OperandType values.
+ */
+constexpr size_t OPERAND_TYPE_COUNT = static_cast<size_t>(OperandType::COUNT);
+
+constexpr bool is_register(OperandType type)
+{
+    return type == OperandType::REG8 || type == OperandType::REG16;
+}
+
+constexpr bool is_memory(OperandType type)
+{
+    return type == OperandType::MEM8 || type == OperandType::MEM16;
+}
+
+constexpr bool is_immediate(OperandType type)
+{
+    return type == OperandType::IMM8 || type == OperandType::IMM16;
+}
+
+/**
+ * @enum BranchKind
+ * @brief How a relative branch is encoded and whether it can be widened.
+ */
+enum class BranchKind : uint8_t {
+    NONE, /**< Not a relative branch. */
+    JMP,  /**< JMP: rel8 (EB), widened to rel16 (E9). */
+    JCC,  /**< Conditional jump: rel8 (7x), widened to the inverted Jcc over a JMP rel16. */
+    LOOP, /**< LOOP: rel8 only. */
+    CALL  /**< CALL: always rel16 (E8). */
 };
 
 /**
@@ -61,112 +96,178 @@ struct OpcodeInfo {
     bool has_imm;            /**< True if the instruction contains an immediate value. */
     int imm_size;            /**< Size of the immediate value in bytes (0 if none). */
     uint8_t opcode_ext;      /**< NEW: ModR/M reg field for group instructions. */
+    BranchKind branch;       /**< Relative branch kind; the immediate is then the target address. */
 };
 
+struct AsmContext;
+struct IrInstr;
+class ByteWriter;
+
 /**
- * @struct OperandKey
- * @brief Represents a lookup key for an opcode map.
- *
- * The key is based on the mnemonic string and the types of up to two operands.
- * Used in a hash map to retrieve the corresponding OpcodeInfo.
+ * @brief Pass 2 encoder of one instruction form; see encoder.h.
  */
-struct OperandKey {
-    std::string mnemonic; /**< Instruction mnemonic (e.g., "MOV", "ADD"). */
-    OperandType op1;      /**< Type of the first operand. */
-    OperandType op2;      /**< Type of the second operand. */
-
-    /**
-     * @brief Equality operator for OperandKey.
-     * @param other The OperandKey to compare against.
-     * @return True if mnemonic and both operand types match.
-     */
-    bool operator==(const OperandKey &other) const {
-        return mnemonic == other.mnemonic && op1 == other.op1 && op2 == other.op2;
-    }
-};
+using FormEncoder = void (*)(const AsmContext &ctx, const IrInstr &instr, const OpcodeInfo &info, ByteWriter out);
 
+/**
+ * @struct ParsedOperand
+ * @brief One instruction operand as parsed from the tokens of a line.
+ *
+ * value is a view into the source text (for memory operands, the text
+ * between the brackets), so parsing an operand never allocates.
+ */
 struct ParsedOperand {
     OperandType type;
-    std::string value;
-    uint8_t reg_code;
-    uint8_t seg_code;
-    uint8_t modrm_rm;
-    int16_t displacement;
+    std::string_view value;
+    long imm;                /**< Numeric value of an immediate operand. */
+    Register8 reg8;          /**< Register of a REG8 operand, as classified by the lexer. */
+    Register16 reg16;        /**< Register of a REG16 operand, as classified by the lexer. */
+    SegmentRegister segreg;  /**< Register of a SEGREG operand, as classified by the lexer. */
+    uint8_t modrm_mod;       /**< ModR/M mod field of a memory operand, chosen from its displacement. */
+    uint8_t modrm_rm;        /**< ModR/M r/m field of a memory operand. */
+    int16_t displacement;    /**< Displacement of a memory operand; added to the label if there is one. */
+    uint8_t seg_prefix;      /**< Segment override prefix byte of a memory operand, 0 if none. */
+    bool symbol;             /**< True if the immediate, or the displacement of a memory operand, is a symbol resolved in pass 2. */
+    uint32_t symbol_id;      /**< Symbol id of the name of a symbolic immediate. */
+    bool local;              /**< True if the symbol is a local label (.name). */
 };
 
-ParsedOperand parseOperand(const std::vector<std::string>& tokens,
-                           const std::vector<std::string>& lexemes,
+/**
+ * @brief Hardware number of each Register8, as used in the ModR/M reg and r/m fields.
+ */
+inline constexpr uint8_t reg8_codes[] = {0, 0, 3, 1, 2, 4, 7, 5, 6};
+static_assert(sizeof(reg8_codes) == REG8_DH + 1, "one code per Register8");
+
+/**
+ * @brief Hardware number of each Register16, as used in the ModR/M reg and r/m fields.
+ */
+inline constexpr uint8_t reg16_codes[] = {0, 0, 3, 1, 2, 6, 7, 5, 4};
+static_assert(sizeof(reg16_codes) == REG16_SP + 1, "one code per Register16");
+
+/**
+ * @brief Range of an imm16 operand: signed or unsigned 16-bit.
+ */
+inline constexpr long IMM16_MIN = -32768;
+inline constexpr long IMM16_MAX = 0xFFFF;
+
+/**
+ * @brief Hardware number of each SegmentRegister, as used in the ModR/M reg field of MOV Sreg.
+ */
+inline constexpr uint8_t seg_codes[] = {0, 1, 3, 2, 0, 4, 5};
+static_assert(sizeof(seg_codes) == SEGREG_GS + 1, "one code per SegmentRegister");
+
+/**
+ * @brief Parses one operand starting at tokens[idx] and advances idx past it.
+ *
+ * @param tokens Tokens of the current line.
+ * @param idx Index of the first token of the operand; updated to the token after it.
+ * @return ParsedOperand The parsed operand.
+ */
+ParsedOperand parseOperand(const LineView& tokens,
                            size_t& idx);
 
 /**
- * @struct OperandKeyHash
- * @brief Custom hash functor for OperandKey.
+ * @class OpcodeTable
+ * @brief Read-only opcode table indexed by (mnemonic, op1 type, op2 type).
  *
- * Allows OperandKey to be used as a key in std::unordered_map
- * by combining the hashes of the mnemonic and operand types.
+ * The table is built at compile time. Every (InstructionType, OperandType,
+ * OperandType) triple owns one byte in a dense slot array; a non-zero slot
+ * is the 1-based index of its OpcodeInfo in the form list. A lookup is two
+ * array loads and never allocates.
  */
-struct OperandKeyHash {
+class OpcodeTable
+{
+public:
+    /** Maximum number of encodable instruction forms in the table. */
+    static constexpr size_t MAX_FORMS = 255;
+
+    constexpr OpcodeTable() : slots{}, forms{}, operands{}, encoders{}, form_count(0) {}
+
     /**
-     * @brief Computes a hash value for the given OperandKey.
-     * @param k The OperandKey to hash.
-     * @return A size_t hash value for the key.
+     * @brief Registers the encoding of one instruction form.
+     *
+     * @param mnemonic Instruction type of the mnemonic.
+     * @param op1 Type of the first operand.
+     * @param op2 Type of the second operand.
+     * @param info Encoding details for this form.
      */
-    std::size_t operator()(const OperandKey& k) const {
-        return std::hash<std::string>()(k.mnemonic)
-             ^ (std::hash<int>()((int)k.op1) << 1)
-             ^ (std::hash<int>()((int)k.op2) << 2);
+    constexpr void add(InstructionType mnemonic, OperandType op1, OperandType op2, OpcodeInfo info)
+    {
+        forms[form_count] = info;
+        operands[form_count][0] = op1;
+        operands[form_count][1] = op2;
+        form_count++;
+        slots[index(mnemonic, op1, op2)] = static_cast<uint8_t>(form_count);
     }
-};
 
-// No operand instructions (including implicit operand string instructions)
-const std::unordered_map<std::string, int> no_operand_instructions = {
-    {"HLT", 0}, {"NOP", 0}, {"RET", 0}, {"LEAVE", 0},
-    {"LOCK", 0}, {"WAIT", 0}, {"SALC", 0}, {"CLC", 0},
-    {"STC", 0}, {"CMC", 0}, {"CLI", 0}, {"STD", 0},
-    {"CLD", 0}, {"ESC", 0}, {"INT3", 0}, {"IRET", 0},
-    {"SYSCALL", 0}, {"SYSRET", 0}, {"PUSHA", 0}, {"POPA", 0},
-    {"LODS", 0}, {"LODSB", 0}, {"LODSW", 0}, {"LODSD", 0}, {"LODSQ", 0},
-    {"STOS", 0}, {"SCAS", 0}, {"CMPS", 0}, {"REP", 0}, {"REPE", 0}, {"REPNE", 0},
-    {"LOOP", 0}
-};
+    /**
+     * @brief Stores the encoder of every registered form.
+     *
+     * @param pick Called as pick(op1, op2, info) for each form; returns its encoder.
+     */
+    template <typename Pick>
+    constexpr void bind_encoders(Pick pick)
+    {
+        for (size_t i = 0; i < form_count; i++)
+            encoders[i] = pick(operands[i][0], operands[i][1], forms[i]);
+    }
 
-// One operand instructions
-const std::unordered_map<std::string, int> one_operand_instructions = {
-    {"INT", 1}, {"PUSH", 1}, {"POP", 1}, {"INC", 1}, {"DEC", 1},
-    {"NOT", 1}, {"NEG", 1}, {"SHL", 1}, {"SAL", 1}, {"SHR", 1},
-    {"SAR", 1}, {"JMP", 1}, {"JE", 1}, {"JNE", 1}, {"JZ", 1},
-    {"JNZ", 1}, {"JG", 1}, {"JGE", 1}, {"JL", 1}, {"JLE", 1},
-    {"JA", 1}, {"JAE", 1}, {"JB", 1}, {"JBE", 1}, {"JS", 1},
-    {"JNS", 1}, {"CALL", 1}, {"SET", 1}, {"IN", 1}, {"OUT", 1},
-    {"ARPL", 1}, {"CLTS", 1}, {"INVLPG", 1}, {"VERR", 1}, {"VERW", 1},
-    {"STR", 1}, {"LTR", 1}, {"LGDT", 1}, {"SGDT", 1},
-    {"LIDT", 1}, {"SIDT", 1}, {"IDIV", 1}
-};
+    /**
+     * @brief Finds the encoding of an instruction form.
+     *
+     * @return Pointer to the OpcodeInfo, or nullptr if the form is not encodable.
+     */
+    constexpr const OpcodeInfo *find(InstructionType mnemonic, OperandType op1, OperandType op2) const
+    {
+        const uint8_t slot = slots[index(mnemonic, op1, op2)];
+        return slot ? &forms[slot - 1] : nullptr;
+    }
 
-// Two operand instructions
-const std::unordered_map<std::string, int> two_operand_instructions = {
-    {"MOV", 2}, {"LEA", 2}, {"ADD", 2}, {"SUB", 2}, {"IMUL", 2},
-    {"AND", 2}, {"OR", 2}, {"XOR", 2}, {"TEST", 2}, {"CMP", 2},
-    {"XCHG", 2}, {"MOVSX", 2}, {"MOVZX", 2}, {"BOUND", 2}, {"MOVCR", 2}
-};
+    /**
+     * @brief Finds the id of an instruction form, for storing in compact records.
+     *
+     * @return 1-based form id, or 0 if the form is not encodable.
+     */
+    constexpr uint8_t find_form(InstructionType mnemonic, OperandType op1, OperandType op2) const
+    {
+        return slots[index(mnemonic, op1, op2)];
+    }
+
+    /**
+     * @brief Returns the encoding of a form id obtained from find_form().
+     */
+    constexpr const OpcodeInfo &form(uint8_t id) const
+    {
+        return forms[id - 1];
+    }
+
+    /**
+     * @brief Returns the pass 2 encoder of a form id obtained from find_form().
+     */
+    constexpr FormEncoder encoder(uint8_t id) const
+    {
+        return encoders[id - 1];
+    }
 
+private:
+    static constexpr size_t index(InstructionType mnemonic, OperandType op1, OperandType op2)
+    {
+        return (static_cast<size_t>(mnemonic) * OPERAND_TYPE_COUNT + static_cast<size_t>(op1)) * OPERAND_TYPE_COUNT + static_cast<size_t>(op2);
+    }
 
+    uint8_t slots[INSTRUCTION_TYPE_COUNT * OPERAND_TYPE_COUNT * OPERAND_TYPE_COUNT];
+    OpcodeInfo forms[MAX_FORMS];
+    OperandType operands[MAX_FORMS][2];
+    FormEncoder encoders[MAX_FORMS];
+    size_t form_count;
+};
 
 /**
- * @brief Global opcode map.
+ * @brief Global opcode table, built at compile time in opcode_table.cpp.
  *
- * Maps an OperandKey (mnemonic + operand types) to an OpcodeInfo structure
+ * Maps (mnemonic, operand types) to an OpcodeInfo structure
  * containing the binary encoding details for that instruction.
  */
-extern std::unordered_map<OperandKey, OpcodeInfo, OperandKeyHash> opcode_map;
-
-/**
- * @brief Initializes the opcode table.
- *
- * Populates the opcode_map with all supported instructions
- * and their corresponding binary encoding details.
- */
-void init_opcode_table();
+extern const OpcodeTable opcode_table;
 
 #endif // __cplusplus
 #endif // OPCODE_TABLE_H
@@ -20,40 +20,31 @@
 #define PARSER_H
 
 #ifdef __cplusplus
-#include <string>
-#include <vector>
-extern "C" {
-#endif
+#include <cstddef>
+#include "asm_context.h"
 
 /**
- * @brief Processes a single tokenized line passed from the lexer.
- * 
- * This function takes a formatted token string (e.g., 
- * "Token: INSTR_MOV Lexeme: MOV") generated by the lexer, 
- * parses its content, and performs syntax analysis or other
- * processing depending on the token types and lexemes.
- * 
- * It is designed to be called after each line is processed by
- * the lexer and converted into a formatted string.
- * 
- * @param token_line A string containing the formatted token information 
- *                   from the lexer. Each call represents one token line.
+ * @brief Pass 1 over all lines of the token store of the context.
+ *
+ * With one thread, or few lines, the lines are parsed in order straight
+ * into the context. Otherwise they are cut into pieces that are parsed
+ * and sized on up to the given number of threads, each piece counting
+ * its addresses from zero.
+ * A scan in source order then gives every piece its start address and
+ * its place in the IR, and the pieces are moved into place in parallel.
+ * Lines whose meaning depends on the location counter (ORG, BITS and
+ * TIMES with $ in its count) are pieces of their own that the scan
+ * handles with the real location counter.
+ *
+ * The IR, tables, diagnostics and lexer errors come out the same either
+ * way, including which line stops the file on an error: the lexer errors
+ * held in ctx.lexer_errors are written up to that line only, and any of
+ * them marks the file as failed.
+ *
+ * @param ctx The assembly whose lines are parsed.
+ * @param threads Number of threads pass 1 may use.
  */
-void parser_process_line(const char *token_line);
-
-#ifdef __cplusplus
-}
-#endif
-
-#ifdef __cplusplus
-
-struct Token {
-    std::string type;
-    std::string lexeme;
-};
-
-void parse_token_and_lexeme(const Token& token);
+void parser_process_lines(AsmContext &ctx, size_t threads);
 
 #endif // __cplusplus
-
 #endif // PARSER_H
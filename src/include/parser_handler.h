@@ -23,33 +23,50 @@
 #include <vector>
 #include <string>
 #include <cstdint>
+#include <string_view>
 #include "opcode_table.h"
+#include "line_view.h"
+#include "asm_context.h"
 
-void handle_parse(std::vector<std::string> token_vector, std::vector<std::string> lexeme_vector);
+void handle_parse(AsmContext &ctx, const LineView &line);
 
-std::string stringAndNumberToHex(const std::string &text, const std::string &numberStr);
+int incByte(InstructionType defineSize);
 
-std::string stringToHexInString(const std::string &text);
+OperandType get_operand_type_from_token(const Token &token);
 
-std::vector<uint8_t> hexStringToBytes(const std::string &hexStr);
+void handle_times(AsmContext &ctx, int count, InstructionType defineSize, const Token &operand, bool padding);
 
-bool is_label_token(const std::string &token, const std::string &lexeme);
+int evaluateExpr(std::string_view expr, int currentAddr, int baseAddr);
 
-std::string strip_label(const std::vector<std::string> &tokens, const std::vector<std::string> &lexemes, size_t idx);
+void handleTimesDirective(AsmContext &ctx, const LineView &line);
 
-OperandType get_operand_type_from_token(const std::string &token, const std::string &lexeme);
+void handleInstructions(AsmContext &ctx, const LineView &line);
 
-int stringToHexNumber(const std::string &input);
+/**
+ * @brief Returns the value of the symbolic immediate of an IR instruction.
+ *
+ * Labels (including data labels) are looked up first, then EQU symbols
+ * with a numeric value; a local label (.name) only among the local labels
+ * of the non-local label it follows. Throws AssemblyError for an
+ * undefined symbol.
+ */
+long resolveSymbol(const AsmContext &ctx, const IrInstr &instr);
 
-void handle_times(int count, const std::string &defineSize, const std::string &operandToken, const std::string &operandLexeme);
+void encodeInstruction(const AsmContext &ctx, const IrInstr &instr, uint8_t *dest, std::string *listing);
 
-int evaluateExpr(const std::string &expr, int currentAddr, int baseAddr);
-
-void handleTimesDirective(const std::vector<std::string> &token_vector,
-                          const std::vector<std::string> &lexeme_vector,
-                          int *lcPointer, int *blcPointer);
-
-void handleInstructions(std::vector<std::string> token_vector, std::vector<std::string> lexeme_vector);
+/**
+ * @brief Pass 2: encodes every instruction pass 1 collected in the context.
+ *
+ * The bytes of the instructions and data directives go into ctx.image at
+ * their addresses. If ctx.listing is set, every encoded field is also
+ * listed in ctx.out. Large files are split into chunks that are encoded
+ * on up to ctx.threads threads; each chunk writes its own slice of the
+ * image and its own listing, and the listings are joined in order, so
+ * the result is the same as encoding serially.
+ *
+ * @param ctx The assembly whose IR is encoded.
+ */
+void encodeInstructions(AsmContext &ctx);
 
 int parseExpression(const std::string &s, size_t &pos);
 
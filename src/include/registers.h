@@ -19,6 +19,10 @@
 #ifndef REGISTERS_H
 #define REGISTERS_H
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 /**
  * @brief Enum for 8-bit general-purpose registers.
  */
@@ -181,5 +185,8 @@ const char *reg16_type_to_string(Register16 reg_type);
  */
 const char *segreg_type_to_string(SegmentRegister reg_type);
 
+#ifdef __cplusplus
+}
+#endif // __cplusplus
 
 #endif // REGISTERS_H
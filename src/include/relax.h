@@ -0,0 +1,44 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Branch relaxation between pass 1 and pass 2.
+
+#ifndef RELAX_H
+#define RELAX_H
+
+#ifdef __cplusplus
+#include "asm_context.h"
+
+/**
+ * @brief Picks the smallest encoding for every relative branch in the IR.
+ *
+ * Pass 1 sizes every JMP, Jcc and LOOP as rel8. This widens the branches
+ * whose target is out of rel8 range (JMP to rel16, Jcc to the inverted
+ * Jcc over a JMP rel16) until every branch reaches its target, then
+ * moves the addresses of the instructions, labels and data after them.
+ *
+ * Branches only ever grow, so the result is reached from a worklist:
+ * a widened branch only puts back the short branches that jump across
+ * it. Throws AssemblyError for a LOOP whose target is out of range.
+ *
+ * @param ctx The assembly whose IR and labels are updated.
+ */
+void relax_branches(AsmContext &ctx);
+
+#endif // __cplusplus
+#endif // RELAX_H
@@ -0,0 +1,74 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Vectorized scanning of source text for the lexer.
+
+#ifndef SCAN_H
+#define SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Returns the first '\n' or NUL byte at or after p.
+ *
+ * Used to skip comment bodies. The bytes between p and end are compared
+ * 16 or 32 at a time, depending on what the CPU supports.
+ *
+ * @param p Where to start.
+ * @param end Limit of the block reads. A '\n' or NUL byte must come at or
+ *            before end; the bytes after the last whole block are
+ *            checked one at a time until one is found.
+ * @return const char* The '\n' or NUL byte.
+ */
+const char *scan_line_end(const char *p, const char *end);
+
+/**
+ * @brief Returns the first quote, '\n' or NUL byte at or after p.
+ *
+ * Used to find the end of a string literal.
+ *
+ * @param p Where to start.
+ * @param end Limit of the block reads. A '\n' or NUL byte must come at or
+ *            before end, as for scan_line_end().
+ * @param quote The quote character that closes the string.
+ * @return const char* The quote, '\n' or NUL byte.
+ */
+const char *scan_string_end(const char *p, const char *end, char quote);
+
+/**
+ * @brief Returns the first byte at or after p that is not ' ', '\t' or '\r'.
+ *
+ * @param p Where to start.
+ * @param end Limit of the block reads. A byte other than ' ', '\t' or
+ *            '\r' must come at or before end.
+ * @return const char* The first byte after the whitespace run.
+ */
+const char *scan_skip_spaces(const char *p, const char *end);
+
+/**
+ * @brief Returns the name of the implementation picked for this CPU: "avx2", "sse2" or "scalar".
+ */
+const char *scan_implementation(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SCAN_H
@@ -0,0 +1,66 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Whole-file source input.
+
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The complete contents of a source file in memory.
+ *
+ * data[size] is always a readable NUL byte, so the lexer can scan the
+ * buffer like a C string without bounds checks.
+ */
+typedef struct
+{
+    const char *data; /**< File contents, followed by a NUL byte */
+    size_t size;      /**< Size of the file in bytes */
+    int mapped;       /**< Non-zero if data is a memory mapping, zero if it is heap memory */
+} SourceBuffer;
+
+/**
+ * @brief Loads a whole source file.
+ *
+ * The file is memory-mapped when the platform allows it and the mapping
+ * ends with a zero-filled page tail; otherwise it is read in one go.
+ *
+ * @param path Path of the file to load.
+ * @param source Receives the loaded buffer.
+ * @return int 0 on success, -1 on failure (errno is set).
+ */
+int source_load(const char *path, SourceBuffer *source);
+
+/**
+ * @brief Releases a buffer obtained from source_load().
+ *
+ * @param source The buffer to release.
+ */
+void source_release(SourceBuffer *source);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SOURCE_H
@@ -0,0 +1,143 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Assembler statistics (enabled with --stats).
+
+#ifndef STATS_H
+#define STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Phases of the assembler that can be timed.
+ */
+typedef enum
+{
+    STATS_PHASE_LEX,    /**< Splitting the source into tokens */
+    STATS_PHASE_PARSE,  /**< Pass 1: line dispatch, operand parsing, opcode lookup and sizing into the IR */
+    STATS_PHASE_RELAX,  /**< Branch relaxation between the passes */
+    STATS_PHASE_ENCODE, /**< Pass 2: instruction encoding from the IR (ModR/M, immediates) */
+    STATS_PHASE_COUNT   /**< Number of phases (not a phase) */
+} StatsPhase;
+
+/**
+ * @brief Turns statistics collection on. Off by default.
+ */
+void stats_enable(void);
+
+/**
+ * @brief Returns non-zero if statistics collection is on.
+ */
+int stats_enabled(void);
+
+/**
+ * @brief Counts encoded instructions.
+ *
+ * @param count Number of instructions encoded.
+ */
+void stats_count_instructions(unsigned long long count);
+
+/**
+ * @brief Counts one non-empty source line handed to the parser.
+ */
+void stats_count_line(void);
+
+/**
+ * @brief Counts the relaxable branches of a file and how many had to be widened.
+ *
+ * @param total Number of JMP, Jcc and LOOP instructions.
+ * @param widened Number of them that did not fit in rel8.
+ */
+void stats_count_branches(unsigned long long total, unsigned long long widened);
+
+/**
+ * @brief Counts one source file that was assembled (or failed to assemble).
+ */
+void stats_count_file(void);
+
+/**
+ * @brief Counts the bytes of a loaded source file.
+ *
+ * @param count Size of the file in bytes.
+ */
+void stats_count_source_bytes(unsigned long long count);
+
+/**
+ * @brief Counts a block that the arena of an assembly took from the heap.
+ *
+ * @param bytes Size of the block.
+ */
+void stats_count_arena_block(unsigned long long bytes);
+
+/**
+ * @brief Counts the encode cache lookups of a chunk of pass 2 and how many of them hit.
+ *
+ * @param lookups Instructions without a label reference looked up in the cache.
+ * @param hits Lookups that found the finished encoding.
+ */
+void stats_count_encode_cache(unsigned long long lookups, unsigned long long hits);
+
+/**
+ * @brief Starts timing a phase. Does nothing if statistics are off.
+ *
+ * A phase started while another one runs on the same thread pauses the
+ * outer phase until it ends, so the lexer time does not include the
+ * parsing done between tokens.
+ *
+ * @param phase The phase to time.
+ */
+void stats_phase_begin(StatsPhase phase);
+
+/**
+ * @brief Stops timing a phase and adds the elapsed time to its total.
+ *
+ * Phases are timed per thread, so with several worker threads the totals
+ * are CPU time summed over the threads, not wall time.
+ *
+ * @param phase The innermost phase started with stats_phase_begin().
+ */
+void stats_phase_end(StatsPhase phase);
+
+/**
+ * @brief Stops all phases running on this thread, after an error ended them early.
+ */
+void stats_phase_abort(void);
+
+/**
+ * @brief Returns the number of heap allocations made through operator new so far.
+ *
+ * Counted only after stats_enable(); phases record how many allocations
+ * their own thread made while they were being timed.
+ */
+unsigned long long stats_allocations(void);
+
+/**
+ * @brief Prints the collected statistics to stderr.
+ *
+ * Besides the phase totals this shows the lexer throughput in MB/s, the
+ * wall time since stats_enable() and the number of files per second.
+ */
+void stats_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STATS_H
@@ -0,0 +1,141 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Struct-of-arrays store of the tokens of a whole source file.
+
+#ifndef TOKEN_STORE_H
+#define TOKEN_STORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "lexer.h"
+#include "interner.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The tokens of one source file, one array per field.
+ *
+ * Token i has the kind kinds[i], the payload payloads[i] and the lexeme
+ * source + offsets[i] of lengths[i] bytes. The payload is
+ * - the instruction of a keyword TOKEN_INSTR,
+ * - the bitwise NOT of the symbol id of a plain identifier (a TOKEN_INSTR
+ *   with INSTR_GENERIC), which makes it negative,
+ * - the symbol id of a TOKEN_LABEL,
+ * - the register of a TOKEN_REG8, TOKEN_REG16 or TOKEN_SEGREG,
+ * - the value of a TOKEN_NUMBER or TOKEN_STRING, truncated to 32 bits
+ *   like IR immediates,
+ * - and 0 for other kinds.
+ *
+ * Comments and empty lines are left out, so every line in the store has
+ * at least one token before its TOKEN_EOL. A token takes 13 bytes here
+ * instead of the 56 of a Token, and the parser walks the arrays front to
+ * back.
+ */
+typedef struct
+{
+    const char *source;     /**< The source text the offsets point into */
+    unsigned char *kinds;   /**< TokenType of each token */
+    int32_t *payloads;      /**< Instruction, register or value of each token */
+    uint32_t *offsets;      /**< Start of each lexeme in source */
+    uint32_t *lengths;      /**< Length of each lexeme in bytes */
+    size_t count;           /**< Number of tokens */
+    size_t capacity;        /**< Number of tokens the arrays have room for */
+    uint32_t *line_ends;    /**< Index just after the TOKEN_EOL of each line */
+    uint32_t *line_numbers; /**< Source line number of each line */
+    size_t line_count;      /**< Number of lines */
+    size_t line_capacity;   /**< Number of lines the arrays have room for */
+    Interner symbols;       /**< Ids of the labels and plain identifiers */
+} TokenStore;
+
+/**
+ * @brief Prepares an empty store for the tokens of a source text.
+ *
+ * @param store The store to initialize.
+ * @param source The source text the tokens will come from.
+ */
+void token_store_init(TokenStore *store, const char *source);
+
+/**
+ * @brief Lexes the rest of the input of a lexer into a store.
+ *
+ * Lexer errors are reported through the lexer's callback as they are
+ * found; at that point store->count is the index the offending token gets.
+ *
+ * @param store The store to append to. Its source must be the lexer's input.
+ * @param lexer The lexer to read from until TOKEN_EOF.
+ * @return int 0 on success, -1 if memory ran out or the source is larger than 4 GiB.
+ */
+int token_store_fill(TokenStore *store, Lexer *lexer);
+
+/**
+ * @brief Makes room for at least the given number of tokens and lines.
+ *
+ * @param store The store to grow; the tokens it has are kept.
+ * @param tokens Number of tokens the store must hold.
+ * @param lines Number of lines the store must hold.
+ * @return int 0 on success, -1 if memory ran out.
+ */
+int token_store_reserve(TokenStore *store, size_t tokens, size_t lines);
+
+/**
+ * @brief Gives the symbols of one store ids in another.
+ *
+ * Must be called in the order the stores are concatenated, so that ids
+ * still follow the order in which names first appear in the file.
+ *
+ * @param dest The store whose interner gets the names.
+ * @param src The store whose names are interned.
+ * @param map Receives the id in dest of each id of src; src->symbols.count entries.
+ * @return int 0 on success, -1 if memory ran out.
+ */
+int token_store_map_symbols(TokenStore *dest, const TokenStore *src, uint32_t *map);
+
+/**
+ * @brief Copies the tokens and lines of one store into another at the given positions.
+ *
+ * The line ends are moved by token_at, the line numbers by line_base and
+ * the symbol ids are translated through symbol_map.
+ * The destination must already have room for the copy and its counts are
+ * left alone, so several stores can be copied into disjoint parts of one
+ * store at the same time; the caller sets the counts afterwards.
+ *
+ * @param dest The store to copy into. Both stores must share their source.
+ * @param token_at Index in dest of the first token of src.
+ * @param line_at Index in dest of the first line of src.
+ * @param src The store to copy from.
+ * @param line_base Number of source lines before the part src was lexed from.
+ * @param symbol_map Id in dest of each symbol id of src, from token_store_map_symbols().
+ */
+void token_store_copy(TokenStore *dest, size_t token_at, size_t line_at, const TokenStore *src, uint32_t line_base,
+                      const uint32_t *symbol_map);
+
+/**
+ * @brief Frees the arrays of a store and leaves it empty.
+ *
+ * @param store The store to release.
+ */
+void token_store_free(TokenStore *store);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TOKEN_STORE_H
@@ -17,34 +17,13 @@
 */
 
 #include <string.h>
-#include <ctype.h>
 #include "include/instructions.h"
-
-/**
- * @brief Case-insensitive string compare.
- *
- * @param s1 First string.
- * @param s2 Second string.
- * @return 0 if equal (case-insensitive), non-zero otherwise.
- */
-static int strcasecmp_custom(const char *s1, const char *s2)
-{
-    while (*s1 && *s2)
-    {
-        if (tolower((unsigned char)*s1) != tolower((unsigned char)*s2))
-        {
-            return (int)((unsigned char)tolower(*s1) - (unsigned char)tolower(*s2));
-        }
-        s1++;
-        s2++;
-    }
-    return (int)((unsigned char)tolower(*s1) - (unsigned char)tolower(*s2));
-}
+#include "include/keywords.h"
 
 /**
  * @brief Get the instruction or directive type from mnemonic.
  *
- * @param lexeme The mnemonic string to lookup.
+ * @param lexeme The mnemonic string to lookup (any case).
  * @return InstructionType for the mnemonic or INSTR_GENERIC if not found.
  */
 InstructionType get_instruction_type(const char *lexeme)
@@ -54,15 +33,8 @@ InstructionType get_instruction_type(const char *lexeme)
         return INSTR_GENERIC;
     }
 
-    for (int i = 0; instruction_table[i].mnemonic != NULL; i++)
-    {
-        if (strcasecmp_custom(instruction_table[i].mnemonic, lexeme) == 0)
-        {
-            return instruction_table[i].type;
-        }
-    }
-
-    return INSTR_GENERIC;
+    const Keyword *keyword = keyword_find(lexeme, (int)strlen(lexeme));
+    return keyword != NULL ? keyword->instr_type : INSTR_GENERIC;
 }
 
 /**
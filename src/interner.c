@@ -0,0 +1,142 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// interner.c
+
+#include <stdlib.h>
+#include <string.h>
+#include "include/interner.h"
+
+void interner_init(Interner *interner, const char *source)
+{
+    interner->source = source;
+    interner->offsets = NULL;
+    interner->lengths = NULL;
+    interner->hashes = NULL;
+    interner->count = 0;
+    interner->capacity = 0;
+    interner->slots = NULL;
+    interner->slot_mask = 0;
+}
+
+void interner_free(Interner *interner)
+{
+    free(interner->offsets);
+    free(interner->lengths);
+    free(interner->hashes);
+    free(interner->slots);
+    interner_init(interner, interner->source);
+}
+
+/**
+ * @brief FNV-1a hash of a name.
+ */
+static uint32_t hash_name(const char *name, uint32_t length)
+{
+    uint32_t hash = 2166136261u;
+    for (uint32_t i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char)name[i]) * 16777619u;
+    return hash;
+}
+
+/**
+ * @brief Doubles the id arrays and the hash table, rehashing the names from their kept hashes.
+ */
+static int grow(Interner *interner)
+{
+    const uint32_t capacity = interner->capacity ? interner->capacity * 2 : 1024;
+    if (capacity <= interner->capacity)
+        return -1;
+
+    uint32_t *offsets = realloc(interner->offsets, capacity * sizeof *offsets);
+    if (offsets == NULL)
+        return -1;
+    interner->offsets = offsets;
+
+    uint32_t *lengths = realloc(interner->lengths, capacity * sizeof *lengths);
+    if (lengths == NULL)
+        return -1;
+    interner->lengths = lengths;
+
+    uint32_t *hashes = realloc(interner->hashes, capacity * sizeof *hashes);
+    if (hashes == NULL)
+        return -1;
+    interner->hashes = hashes;
+
+    // Twice as many slots as ids keeps the probe sequences short
+    const size_t slot_count = (size_t)capacity * 2;
+    uint32_t *slots = calloc(slot_count, sizeof *slots);
+    if (slots == NULL)
+        return -1;
+    const uint32_t mask = (uint32_t)(slot_count - 1);
+    for (uint32_t id = 0; id < interner->count; id++)
+    {
+        uint32_t slot = hashes[id] & mask;
+        while (slots[slot] != 0)
+            slot = (slot + 1) & mask;
+        slots[slot] = id + 1;
+    }
+
+    free(interner->slots);
+    interner->slots = slots;
+    interner->slot_mask = mask;
+    interner->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Returns the slot that holds a name, or the free slot where it belongs.
+ */
+static uint32_t find_slot(const Interner *interner, const char *name, uint32_t length, uint32_t hash)
+{
+    uint32_t slot = hash & interner->slot_mask;
+    for (uint32_t entry = interner->slots[slot]; entry != 0; entry = interner->slots[slot])
+    {
+        const uint32_t id = entry - 1;
+        if (interner->hashes[id] == hash && interner->lengths[id] == length &&
+            memcmp(interner->source + interner->offsets[id], name, length) == 0)
+            break;
+        slot = (slot + 1) & interner->slot_mask;
+    }
+    return slot;
+}
+
+uint32_t interner_intern(Interner *interner, const char *name, uint32_t length)
+{
+    if (interner->count == interner->capacity && grow(interner) != 0)
+        return INTERNER_NO_ID;
+
+    const uint32_t hash = hash_name(name, length);
+    const uint32_t slot = find_slot(interner, name, length, hash);
+    if (interner->slots[slot] != 0)
+        return interner->slots[slot] - 1;
+
+    const uint32_t id = interner->count++;
+    interner->offsets[id] = (uint32_t)(name - interner->source);
+    interner->lengths[id] = length;
+    interner->hashes[id] = hash;
+    interner->slots[slot] = id + 1;
+    return id;
+}
+
+uint32_t interner_find(const Interner *interner, const char *name, uint32_t length)
+{
+    if (interner->count == 0)
+        return INTERNER_NO_ID;
+    return interner->slots[find_slot(interner, name, length, hash_name(name, length))] - 1;
+}
@@ -0,0 +1,253 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "include/keywords.h"
+#include <cstdint>
+
+// Keywords are at most this long, so every keyword fits in one 64-bit key
+static constexpr int KEY_LENGTH = 8;
+static constexpr int TABLE_BITS = 8;
+static constexpr int BUCKET_BITS = 6;
+static constexpr int TABLE_SIZE = 1 << TABLE_BITS;
+static constexpr int BUCKET_COUNT = 1 << BUCKET_BITS;
+
+/**
+ * @brief A keyword as it is written down below.
+ */
+struct KeywordName
+{
+    const char *name;
+    Keyword keyword;
+};
+
+static constexpr Keyword instr(InstructionType type) { return Keyword{TOKEN_INSTR, type, 0}; }
+static constexpr Keyword reg8(Register8 reg) { return Keyword{TOKEN_REG8, INSTR_GENERIC, reg}; }
+static constexpr Keyword reg16(Register16 reg) { return Keyword{TOKEN_REG16, INSTR_GENERIC, reg}; }
+static constexpr Keyword segreg(SegmentRegister reg) { return Keyword{TOKEN_SEGREG, INSTR_GENERIC, reg}; }
+
+static constexpr KeywordName keyword_names[] = {
+    // Registers
+    {"AL", reg8(REG8_AL)}, {"BL", reg8(REG8_BL)}, {"CL", reg8(REG8_CL)}, {"DL", reg8(REG8_DL)},
+    {"AH", reg8(REG8_AH)}, {"BH", reg8(REG8_BH)}, {"CH", reg8(REG8_CH)}, {"DH", reg8(REG8_DH)},
+    {"AX", reg16(REG16_AX)}, {"BX", reg16(REG16_BX)}, {"CX", reg16(REG16_CX)}, {"DX", reg16(REG16_DX)},
+    {"SI", reg16(REG16_SI)}, {"DI", reg16(REG16_DI)}, {"BP", reg16(REG16_BP)}, {"SP", reg16(REG16_SP)},
+    {"CS", segreg(SEGREG_CS)}, {"DS", segreg(SEGREG_DS)}, {"SS", segreg(SEGREG_SS)},
+    {"ES", segreg(SEGREG_ES)}, {"FS", segreg(SEGREG_FS)}, {"GS", segreg(SEGREG_GS)},
+
+    // Sections
+    {"SECTION", Keyword{TOKEN_SECTION, INSTR_GENERIC, 0}},
+    {"DATA", Keyword{TOKEN_SECTION_TYPE, INSTR_GENERIC, 0}},
+    {"TEXT", Keyword{TOKEN_SECTION_TYPE, INSTR_GENERIC, 0}},
+    {"BSS", Keyword{TOKEN_SECTION_TYPE, INSTR_GENERIC, 0}},
+
+    // Instructions
+    {"MOV", instr(INSTR_MOV)}, {"HLT", instr(INSTR_HLT)}, {"INT", instr(INSTR_INT)},
+    {"PUSH", instr(INSTR_PUSH)}, {"POP", instr(INSTR_POP)}, {"LEA", instr(INSTR_LEA)},
+    {"ADD", instr(INSTR_ADD)}, {"SUB", instr(INSTR_SUB)}, {"INC", instr(INSTR_INC)},
+    {"DEC", instr(INSTR_DEC)}, {"IMUL", instr(INSTR_IMUL)}, {"IDIV", instr(INSTR_IDIV)},
+    {"AND", instr(INSTR_AND)}, {"OR", instr(INSTR_OR)}, {"XOR", instr(INSTR_XOR)},
+    {"NOT", instr(INSTR_NOT)}, {"NEG", instr(INSTR_NEG)}, {"SHL", instr(INSTR_SHL)},
+    {"SAL", instr(INSTR_SAL)}, {"SHR", instr(INSTR_SHR)}, {"SAR", instr(INSTR_SAR)},
+    {"JMP", instr(INSTR_JMP)}, {"JE", instr(INSTR_JE)}, {"JNE", instr(INSTR_JNE)},
+    {"JZ", instr(INSTR_JZ)}, {"JNZ", instr(INSTR_JNZ)}, {"JG", instr(INSTR_JG)},
+    {"JGE", instr(INSTR_JGE)}, {"JL", instr(INSTR_JL)}, {"JLE", instr(INSTR_JLE)},
+    {"JA", instr(INSTR_JA)}, {"JAE", instr(INSTR_JAE)}, {"JB", instr(INSTR_JB)},
+    {"JBE", instr(INSTR_JBE)}, {"CALL", instr(INSTR_CALL)}, {"RET", instr(INSTR_RET)},
+    {"SET", instr(INSTR_SET)}, {"TEST", instr(INSTR_TEST)}, {"JS", instr(INSTR_JS)},
+    {"JNS", instr(INSTR_JNS)}, {"CMP", instr(INSTR_CMP)}, {"XCHG", instr(INSTR_XCHG)},
+    {"LOCK", instr(INSTR_LOCK)}, {"LEAVE", instr(INSTR_LEAVE)}, {"NOP", instr(INSTR_NOP)},
+    {"MOVSX", instr(INSTR_MOVSX)}, {"MOVZX", instr(INSTR_MOVZX)}, {"BOUND", instr(INSTR_BOUND)},
+    {"WAIT", instr(INSTR_WAIT)}, {"LODS", instr(INSTR_LODS)}, {"STOS", instr(INSTR_STOS)},
+    {"SCAS", instr(INSTR_SCAS)}, {"CMPS", instr(INSTR_CMPS)}, {"REP", instr(INSTR_REP)},
+    {"REPE", instr(INSTR_REPE)}, {"REPNE", instr(INSTR_REPNE)}, {"SALC", instr(INSTR_SALC)},
+    {"ARPL", instr(INSTR_ARPL)}, {"CLD", instr(INSTR_CLD)}, {"STD", instr(INSTR_STD)},
+    {"CLC", instr(INSTR_CLC)}, {"STC", instr(INSTR_STC)}, {"CMC", instr(INSTR_CMC)},
+    {"ESC", instr(INSTR_ESC)}, {"IN", instr(INSTR_IN)}, {"OUT", instr(INSTR_OUT)},
+    {"INT3", instr(INSTR_INT3)}, {"IRET", instr(INSTR_IRET)}, {"SYSCALL", instr(INSTR_SYSCALL)},
+    {"SYSRET", instr(INSTR_SYSRET)}, {"CLI", instr(INSTR_CLI)}, {"LOOP", instr(INSTR_LOOP)},
+    {"LODSB", instr(INSTR_LODSB)}, {"LODSW", instr(INSTR_LODSW)}, {"LODSD", instr(INSTR_LODSD)},
+    {"LODSQ", instr(INSTR_LODSQ)}, {"PUSHA", instr(INSTR_PUSHA)}, {"POPA", instr(INSTR_POPA)},
+    {"LGDT", instr(INSTR_LGDT)}, {"SGDT", instr(INSTR_SGDT)}, {"LIDT", instr(INSTR_LIDT)},
+    {"SIDT", instr(INSTR_SIDT)}, {"LTR", instr(INSTR_LTR)}, {"STR", instr(INSTR_STR)},
+    {"MOVCR", instr(INSTR_MOVCR)}, {"CLTS", instr(INSTR_CLTS)}, {"INVLPG", instr(INSTR_INVLPG)},
+    {"VERR", instr(INSTR_VERR)}, {"VERW", instr(INSTR_VERW)},
+
+    // Directives
+    {"ORG", instr(DIRECTIVE_ORG)}, {"BITS", instr(DIRECTIVE_BITS)}, {"DB", instr(DIRECTIVE_DB)},
+    {"DW", instr(DIRECTIVE_DW)}, {"DD", instr(DIRECTIVE_DD)}, {"EQU", instr(DIRECTIVE_EQU)},
+    {"ALIGN", instr(DIRECTIVE_ALIGN)}, {"TIMES", instr(DIRECTIVE_TIMES)},
+    // Not supported yet: DQ, DT, EXTERN, GLOBAL
+};
+
+static constexpr int KEYWORD_COUNT = static_cast<int>(sizeof(keyword_names) / sizeof(keyword_names[0]));
+
+/**
+ * @brief Folds a character of an identifier to upper case by clearing bit 5.
+ *
+ * This maps 'a'-'z' onto 'A'-'Z' and keeps digits, '_' and '.' apart from
+ * letters and from each other, without asking the C locale.
+ */
+static constexpr uint64_t fold(char c)
+{
+    return static_cast<uint64_t>(static_cast<unsigned char>(c) & 0xDF);
+}
+
+/**
+ * @brief Packs an identifier of at most KEY_LENGTH characters into a key.
+ *
+ * Byte i of the key is folded character i; unused bytes are zero, which no
+ * folded identifier character is.
+ */
+static constexpr uint64_t pack_key(const char *text, int length)
+{
+    uint64_t key = 0;
+    for (int i = 0; i < length; i++)
+        key |= fold(text[i]) << (8 * i);
+    return key;
+}
+
+static constexpr int name_length(const char *name)
+{
+    int length = 0;
+    while (name[length] != '\0')
+        length++;
+    return length;
+}
+
+/**
+ * @brief The perfect hash table: keys, what they mean, and the displacement of every bucket.
+ *
+ * A key hashes to a bucket and to a base slot; the slot is the base XOR
+ * the bucket's displacement. The multiplier and the displacements are
+ * chosen while building so that no two keywords share a slot.
+ */
+struct KeywordTable
+{
+    uint64_t multiplier = 0;
+    uint8_t displacement[BUCKET_COUNT] = {};
+    uint64_t keys[TABLE_SIZE] = {}; /**< 0 marks an empty slot. */
+    Keyword keywords[TABLE_SIZE] = {};
+
+    constexpr int bucket(uint64_t hash) const { return static_cast<int>(hash >> (64 - BUCKET_BITS)); }
+    constexpr int base(uint64_t hash) const { return static_cast<int>((hash >> 32) & (TABLE_SIZE - 1)); }
+
+    constexpr int slot(uint64_t key) const
+    {
+        const uint64_t hash = key * multiplier;
+        return base(hash) ^ displacement[bucket(hash)];
+    }
+
+    /**
+     * @brief Tries to place all keywords with the given multiplier.
+     */
+    constexpr bool place(uint64_t mul)
+    {
+        *this = KeywordTable();
+        multiplier = mul;
+
+        uint64_t bucket_keys[BUCKET_COUNT][KEYWORD_COUNT] = {};
+        int bucket_sizes[BUCKET_COUNT] = {};
+        int bucket_first[BUCKET_COUNT][KEYWORD_COUNT] = {};
+        for (int k = 0; k < KEYWORD_COUNT; k++)
+        {
+            const uint64_t key = pack_key(keyword_names[k].name, name_length(keyword_names[k].name));
+            const int b = bucket(key * mul);
+            bucket_first[b][bucket_sizes[b]] = k;
+            bucket_keys[b][bucket_sizes[b]++] = key;
+        }
+
+        // Fill the fullest buckets first, while there is the most room
+        bool done[BUCKET_COUNT] = {};
+        for (int round = 0; round < BUCKET_COUNT; round++)
+        {
+            int b = -1;
+            for (int i = 0; i < BUCKET_COUNT; i++)
+            {
+                if (!done[i] && (b < 0 || bucket_sizes[i] > bucket_sizes[b]))
+                    b = i;
+            }
+            done[b] = true;
+            if (bucket_sizes[b] == 0)
+                continue;
+
+            int d = 0;
+            for (; d < TABLE_SIZE; d++)
+            {
+                bool fits = true;
+                for (int i = 0; i < bucket_sizes[b] && fits; i++)
+                {
+                    const int s = base(bucket_keys[b][i] * mul) ^ d;
+                    if (keys[s] != 0)
+                        fits = false;
+                    for (int j = 0; j < i && fits; j++)
+                        fits = s != (base(bucket_keys[b][j] * mul) ^ d);
+                }
+                if (fits)
+                    break;
+            }
+            if (d == TABLE_SIZE)
+                return false;
+
+            displacement[b] = static_cast<uint8_t>(d);
+            for (int i = 0; i < bucket_sizes[b]; i++)
+            {
+                const int s = base(bucket_keys[b][i] * mul) ^ d;
+                keys[s] = bucket_keys[b][i];
+                keywords[s] = keyword_names[bucket_first[b][i]].keyword;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief Builds the keyword table. Evaluated once, at compile time.
+ */
+static constexpr KeywordTable build_keyword_table()
+{
+    for (int k = 0; k < KEYWORD_COUNT; k++)
+    {
+        const int length = name_length(keyword_names[k].name);
+        if (length > KEY_LENGTH)
+            throw "keyword longer than KEY_LENGTH";
+        for (int j = 0; j < k; j++)
+        {
+            if (pack_key(keyword_names[j].name, name_length(keyword_names[j].name)) ==
+                pack_key(keyword_names[k].name, length))
+                throw "duplicate keyword";
+        }
+    }
+
+    KeywordTable table;
+    for (uint64_t mul = 0x9E3779B97F4A7C15ull;; mul += 2)
+    {
+        if (table.place(mul))
+            return table;
+    }
+}
+
+static constexpr KeywordTable keyword_table = build_keyword_table();
+
+const Keyword *keyword_find(const char *text, int length)
+{
+    if (length <= 0 || length > KEY_LENGTH)
+        return nullptr;
+    const uint64_t key = pack_key(text, length);
+    const int slot = keyword_table.slot(key);
+    return keyword_table.keys[slot] == key ? &keyword_table.keywords[slot] : nullptr;
+}
@@ -23,20 +23,19 @@
 #include "include/lexer.h"
 #include "include/registers.h"
 #include "include/errors.h"
-#include "include/strops.h"
 #include "include/instructions.h"
-#include "include/parser.h"
-
-// Global variable to hold current filename for error reporting
-char g_filename[256] = "";
+#include "include/scan.h"
+#include "include/keywords.h"
 
 /**
- * @brief Sets the current source filename for error messages.
+ * @brief Reports a non-fatal error through the lexer's callback.
  */
-void set_filename(const char *filename)
+static void lexer_error(Lexer *lexer, const char *error_name)
 {
-    strncpy(g_filename, filename, sizeof(g_filename) - 1);
-    g_filename[sizeof(g_filename) - 1] = '\0';
+    if (lexer->report != NULL)
+        lexer->report(lexer->report_data, error_name, lexer->line, lexer->filename);
+    else
+        occur_error(error_name, &lexer->line, lexer->filename);
 }
 
 /**
@@ -44,36 +43,17 @@ void set_filename(const char *filename)
  */
 int is_segment_register(const char *lexeme)
 {
-    return (strcmp(lexeme, "CS") == 0) ||
-           (strcmp(lexeme, "DS") == 0) ||
-           (strcmp(lexeme, "SS") == 0) ||
-           (strcmp(lexeme, "ES") == 0) ||
-           (strcmp(lexeme, "FS") == 0) ||
-           (strcmp(lexeme, "GS") == 0);
-}
-
-/**
- * @brief Returns whether the given position is inside quotes from line start.
- */
-int is_inside_quotes(const char *line_start, const char *pos)
-{
-    int inside = 0;
-    for (const char *c = line_start; c < pos; ++c)
-    {
-        if (*c == '"')
-            inside = !inside;
-    }
-    return inside;
+    return get_register_token_type(lexeme) == TOKEN_SEGREG;
 }
 
 int is_register8(const char *lexeme)
 {
-    return get_register8_by_name(lexeme) != REG8_NONE;
+    return get_register_token_type(lexeme) == TOKEN_REG8;
 }
 
 int is_register16(const char *lexeme)
 {
-    return get_register16_by_name(lexeme) != REG16_NONE;
+    return get_register_token_type(lexeme) == TOKEN_REG16;
 }
 
 /*
@@ -88,534 +68,455 @@ int is_register32(const char *lexeme)
  */
 TokenType get_register_token_type(const char *lexeme)
 {
-    if (is_register8(lexeme))
-        return TOKEN_REG8;
-    if (is_register16(lexeme))
-        return TOKEN_REG16;
-    // if (is_register32(lexeme))
-        // return TOKEN_REG32;
-    if (is_segment_register(lexeme))
-        return TOKEN_SEGREG;
+    const Keyword *keyword = keyword_find(lexeme, (int)strlen(lexeme));
+    if (keyword != NULL && (keyword->type == TOKEN_REG8 || keyword->type == TOKEN_REG16 || keyword->type == TOKEN_SEGREG))
+        return keyword->type;
     return TOKEN_REG;
 }
 
 /**
- * @brief Retrieves the next token from the input string.
+ * @brief Returns the radix a NASM radix letter stands for, or 0 for any other character.
  */
-Token get_next_token(const char **input_ptr, int *line)
+static unsigned radix_letter(char c)
 {
-    Token token;
-    token.line = *line;
-    token.lexeme[0] = '\0';
-
-    const char *p = *input_ptr;
-    const char *line_start = *input_ptr;
-
-    // Skip whitespace
-    while (*p == ' ' || *p == '\t')
-        p++;
-
-    // End of line
-    if (*p == '\n')
+    switch (c | 0x20)
     {
-        token.type = TOKEN_EOL;
-        strcpy(token.lexeme, "<EOL>");
-        p++;
-        *input_ptr = p;
-        return token;
+    case 'b':
+    case 'y':
+        return 2;
+    case 'o':
+    case 'q':
+        return 8;
+    case 'd':
+    case 't':
+        return 10;
+    case 'h':
+    case 'x':
+        return 16;
+    default:
+        return 0;
     }
+}
 
-    // End of file/input
-    if (*p == '\0')
-    {
-        token.type = TOKEN_EOF;
-        strcpy(token.lexeme, "<EOF>");
-        *input_ptr = p;
-        return token;
-    }
+#define XX 0xFF
+#define SEP 0xFE
 
-    // Single character tokens
-    if (*p == ',')
-    {
-        token.type = TOKEN_COMMA;
-        strcpy(token.lexeme, ",");
-        p++;
-        *input_ptr = p;
-        return token;
-    }
+/**
+ * @brief Value of every byte as a digit: 0-9, then 10-35 for the letters
+ * in either case. SEP marks the '_' digit separator.
+ */
+static const unsigned char digit_table[256] = {
+    /* 0x00 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0x10 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0x20 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0x30 */  0,  1,  2,  3,  4,  5,  6,  7,  8,  9, XX, XX, XX, XX, XX, XX,
+    /* 0x40 */ XX, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+    /* 0x50 */ 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, XX, XX, XX, XX, SEP,
+    /* 0x60 */ XX, 10, 11, 12, 13, 14, 15, 16, 17, 18, 19, 20, 21, 22, 23, 24,
+    /* 0x70 */ 25, 26, 27, 28, 29, 30, 31, 32, 33, 34, 35, XX, XX, XX, XX, XX,
+    /* 0x80 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0x90 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0xA0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0xB0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0xC0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0xD0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0xE0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+    /* 0xF0 */ XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX, XX,
+};
+
+#undef XX
 
-    if (*p == '.')
+/**
+ * @brief Parses a numeric literal of the given length; see lexer_parse_number().
+ *
+ * Works on a view into the source, so the literal does not need to be
+ * NUL-terminated. Inlined into the lexer, where plain decimal and 0x
+ * literals cost a table lookup per digit.
+ */
+static inline int parse_number_view(const char *text, int length, long *value)
+{
+    const char *p = text;
+    const char *q = text + length;
+
+    // A radix can be given as a prefix (0x1F, 0b101) or a suffix (1Fh,
+    // 101b); as in NASM, the larger radix wins when both letters are
+    // there, so 0x1b is hex and 0bh is eleven
+    const unsigned prefix = (length > 2 && p[0] == '0') ? radix_letter(p[1]) : 0;
+    const unsigned suffix = (length > 1 && q[-1] > '9') ? radix_letter(q[-1]) : 0;
+    unsigned radix = 10;
+    if (prefix > suffix)
     {
-        token.type = TOKEN_DOT;
-        strcpy(token.lexeme, ".");
-        p++;
-        *input_ptr = p;
-        return token;
+        radix = prefix;
+        p += 2;
     }
-
-    if (*p == ':')
+    else if (suffix > prefix)
     {
-        token.type = TOKEN_COLON;
-        strcpy(token.lexeme, ":");
-        p++;
-        *input_ptr = p;
-        return token;
+        radix = suffix;
+        q--;
     }
 
-    // Comment token, only if not inside quotes
-    if (*p == ';' && !is_inside_quotes(line_start, p))
+    unsigned long result = 0;
+    int any_digit = 0;
+    for (; p < q; p++)
     {
-        token.type = TOKEN_COMMENT;
-        int i = 0;
-        while (*p != '\0' && *p != '\n')
+        const unsigned digit = digit_table[(unsigned char)*p];
+        if (digit >= radix)
         {
-            if (i < (int)sizeof(token.lexeme) - 1)
-                token.lexeme[i++] = *p;
-            p++;
+            if (digit == SEP) // 1111_0000b
+                continue;
+            return -1;
         }
-        token.lexeme[i] = '\0';
-        *input_ptr = p;
-        return token;
+        if (__builtin_mul_overflow(result, radix, &result) || __builtin_add_overflow(result, digit, &result))
+            return -1;
+        any_digit = 1;
     }
+    if (!any_digit)
+        return -1;
 
-    if (*p == ';')
-    {
-        token.type = TOKEN_SEMICOLON;
-        strcpy(token.lexeme, ";");
-        p++;
-        *input_ptr = p;
-        return token;
-    }
+    *value = (long)result;
+    return 0;
+}
 
-    if (*p == '%')
-    {
-        token.type = TOKEN_MODULO;
-        strcpy(token.lexeme, "%");
-        p++;
-        *input_ptr = p;
-        return token;
-    }
+#undef SEP
 
-    if (*p == '*')
-    {
-        token.type = TOKEN_STAR;
-        strcpy(token.lexeme, "*");
-        p++;
-        *input_ptr = p;
-        return token;
-    }
+int lexer_parse_number(const char *text, int length, long *value)
+{
+    return parse_number_view(text, length, value);
+}
 
-    if (*p == '-')
-    {
-        token.type = TOKEN_MINUS;
-        strcpy(token.lexeme, "-");
-        p++;
-        *input_ptr = p;
-        return token;
-    }
+/**
+ * @brief Returns the value of a character constant: the bytes of the
+ * text in little-endian order, so 'ab' is 0x6261.
+ */
+static long char_constant(const char *text, int length)
+{
+    unsigned long value = 0;
+    for (const char *p = text + length; p > text;)
+        value = (value << 8) | (unsigned char)*--p;
+    return (long)value;
+}
 
-    if (*p == '+')
-    {
-        token.type = TOKEN_PLUS;
-        strcpy(token.lexeme, "+");
-        p++;
-        *input_ptr = p;
-        return token;
-    }
+/**
+ * @brief Class of a character at the start of a token.
+ *
+ * The low bits of char_table select what kind of token a character
+ * starts; the high bits say which kinds of token it may continue.
+ */
+typedef enum
+{
+    CC_ERROR,   /**< Cannot start a token */
+    CC_SPACE,   /**< ' ', '\t', and '\r' (part of a CRLF line ending) */
+    CC_EOL,     /**< '\n' */
+    CC_END,     /**< The NUL byte after the source */
+    CC_DIGIT,   /**< Starts a number */
+    CC_ALPHA,   /**< Starts an identifier: letters and '_' */
+    CC_QUOTE,   /**< Starts a string: '\'' and '"' */
+    CC_COMMENT, /**< ';' */
+    CC_PUNCT    /**< A token of its own, see single_char_tokens */
+} CharClass;
+
+#define CH_CLASS 0x0F  /* Mask of the CharClass bits */
+#define CH_SPACE 0x10  /* Skipped between tokens */
+#define CH_IDENT 0x20  /* Continues an identifier: letters, digits, '_' and '.' */
+#define CH_NUMBER 0x40 /* Continues a number: letters, digits and '_' */
+
+#define __ CC_ERROR
+#define SP (CC_SPACE | CH_SPACE)
+#define NL CC_EOL
+#define NU CC_END
+#define DG (CC_DIGIT | CH_IDENT | CH_NUMBER)
+#define AL (CC_ALPHA | CH_IDENT | CH_NUMBER)
+#define QT CC_QUOTE
+#define SC CC_COMMENT
+#define DT (CC_PUNCT | CH_IDENT)
+#define PU CC_PUNCT
 
-    if (*p == '(')
-    {
-        token.type = TOKEN_OPEN_PARENTHESIS;
-        strcpy(token.lexeme, "(");
-        p++;
-        *input_ptr = p;
-        return token;
-    }
+/**
+ * @brief Class and continuation flags of every byte value.
+ *
+ * Scanning a token costs one lookup per character. Bytes outside ASCII
+ * are never part of a token.
+ */
+static const unsigned char char_table[256] = {
+    /* 0x00 */ NU, __, __, __, __, __, __, __, __, SP, NL, __, __, SP, __, __,
+    /* 0x10 */ __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    /* 0x20 */ SP, __, QT, __, PU, PU, __, QT, PU, PU, PU, PU, PU, PU, DT, __,
+    /* 0x30 */ DG, DG, DG, DG, DG, DG, DG, DG, DG, DG, PU, SC, __, __, __, __,
+    /* 0x40 */ __, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,
+    /* 0x50 */ AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, PU, __, PU, __, AL,
+    /* 0x60 */ __, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL,
+    /* 0x70 */ AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, AL, __, __, __, __, __,
+    /* 0x80 */ __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    /* 0x90 */ __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    /* 0xA0 */ __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    /* 0xB0 */ __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    /* 0xC0 */ __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    /* 0xD0 */ __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    /* 0xE0 */ __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+    /* 0xF0 */ __, __, __, __, __, __, __, __, __, __, __, __, __, __, __, __,
+};
+
+#undef __
+#undef SP
+#undef NL
+#undef NU
+#undef DG
+#undef AL
+#undef QT
+#undef SC
+#undef DT
+#undef PU
 
-    if (*p == ')')
-    {
-        token.type = TOKEN_CLOSE_PARENTHESIS;
-        strcpy(token.lexeme, ")");
-        p++;
-        *input_ptr = p;
-        return token;
-    }
+/**
+ * @brief Token types of the CC_PUNCT characters.
+ */
+static const TokenType single_char_tokens[128] = {
+    [','] = TOKEN_COMMA,
+    ['.'] = TOKEN_DOT,
+    [':'] = TOKEN_COLON,
+    ['%'] = TOKEN_MODULO,
+    ['*'] = TOKEN_STAR,
+    ['-'] = TOKEN_MINUS,
+    ['+'] = TOKEN_PLUS,
+    ['('] = TOKEN_OPEN_PARENTHESIS,
+    [')'] = TOKEN_CLOSE_PARENTHESIS,
+    ['['] = TOKEN_OPEN_BRACKET,
+    [']'] = TOKEN_CLOSE_BRACKET,
+    ['$'] = TOKEN_DOLLAR_SIGN,
+};
 
-    if (*p == '[')
+/**
+ * @brief Returns the char_table entry of a character.
+ */
+static inline unsigned char char_info(char c)
+{
+    return char_table[(unsigned char)c];
+}
+
+/**
+ * @brief Classifies an identifier: register, section keyword, instruction or directive.
+ *
+ * Any other identifier is a TOKEN_INSTR with INSTR_GENERIC.
+ */
+static void classify_identifier(Token *token)
+{
+    const Keyword *keyword = keyword_find(token->lexeme, token->length);
+    if (keyword == NULL)
     {
-        token.type = TOKEN_OPEN_BRACKET;
-        strcpy(token.lexeme, "[");
-        p++;
-        *input_ptr = p;
-        return token;
+        token->type = TOKEN_INSTR;
+        return;
     }
 
-    if (*p == ']')
+    token->type = keyword->type;
+    switch (keyword->type)
     {
-        token.type = TOKEN_CLOSE_BRACKET;
-        strcpy(token.lexeme, "]");
-        p++;
-        *input_ptr = p;
-        return token;
+    case TOKEN_INSTR:
+        token->instr_type = keyword->instr_type;
+        break;
+    case TOKEN_REG8:
+        token->t_register8 = (Register8)keyword->reg;
+        break;
+    case TOKEN_REG16:
+        token->t_register16 = (Register16)keyword->reg;
+        break;
+    case TOKEN_SEGREG:
+        token->t_segregister = (SegmentRegister)keyword->reg;
+        break;
+    default:
+        break;
     }
+}
 
-    if (*p == '$')
+/**
+ * @brief Retrieves the next token at the cursor of the lexer.
+ *
+ * The first character of the token selects the scanner through its
+ * class in char_table; numbers and identifiers then run as long as
+ * their continuation flag is set. The lexeme of the returned token
+ * points into the input; it stays valid as long as the input buffer does.
+ */
+Token get_next_token(Lexer *lexer)
+{
+    Token token;
+    token.instr_type = INSTR_GENERIC;
+    token.t_register8 = REG8_NONE;
+    token.t_register16 = REG16_NONE;
+    token.t_segregister = SEGREG_NONE;
+    token.value = 0;
+    token.symbol = 0;
+    token.line = lexer->line;
+
+    const char *p = lexer->cursor;
+
+    // Runs of two or more blanks (indentation, alignment) are skipped in blocks
+    if (char_info(*p) & CH_SPACE)
     {
-        token.type = TOKEN_DOLLAR_SIGN;
-        strcpy(token.lexeme, "$");
         p++;
-        *input_ptr = p;
-        return token;
+        if (char_info(*p) & CH_SPACE)
+            p = scan_skip_spaces(p, lexer->end);
     }
 
-    // String or char literal using single quotes
-    if (*p == '\'' && !is_inside_quotes(line_start, p))
+    token.lexeme = p;
+    token.length = 0;
+
+    switch ((CharClass)(char_info(*p) & CH_CLASS))
     {
-        int i = 0;
-        p++; // skip opening quote
+    case CC_EOL:
+        token.type = TOKEN_EOL;
+        p++;
+        break;
 
-        while (*p != '\'' && *p != '\0' && *p != '\n')
-        {
-            if (i < (int)sizeof(token.lexeme) - 1)
-                token.lexeme[i++] = *p;
-            p++;
-        }
+    case CC_END:
+        token.type = TOKEN_EOF;
+        break;
 
-        if (*p == '\'')
-        {
-            p++; // skip closing quote
-            token.lexeme[i] = '\0';
-            token.type = TOKEN_STRING; // Treat as string!
-            *input_ptr = p;
-            return token;
-        }
-        else
-        {
-            occur_error(ERROR_NO_CLOSING_QUOTE, line, g_filename);
-            goto terminate;
-        }
-    }
+    case CC_PUNCT:
+        token.type = single_char_tokens[(unsigned char)*p];
+        token.length = 1;
+        p++;
+        break;
 
+    // A string is always scanned up to its closing quote in one go, so
+    // between tokens the lexer is never inside quotes: a ';' here starts
+    // a comment and a quote starts a string, without looking back
+    case CC_COMMENT:
+        token.type = TOKEN_COMMENT;
+        p = scan_line_end(p, lexer->end);
+        token.length = (int)(p - token.lexeme);
+        break;
 
-    if (*p == '\"' && !is_inside_quotes(line_start, p))
+    case CC_QUOTE:
     {
-        token.type = TOKEN_STRING;
-        int i = 0;
-        token.lexeme[i++] = *p; // opening quote
+        // The lexeme is the text between the quotes
+        const char quote = *p;
         p++;
+        token.lexeme = p;
+        p = scan_string_end(p, lexer->end, quote);
 
-        // Capture until closing quote or end of line/input
-        while (*p != '"' && *p != '\0' && *p != '\n')
+        if (*p != quote)
         {
-            if (i < (int)sizeof(token.lexeme) - 1)
-                token.lexeme[i++] = *p;
-            p++;
-        }
-
-        if (*p == '"')
-        {
-            token.lexeme[i++] = *p; // closing quote
-            p++;
-        }
-        else
-        {
-            occur_error(ERROR_NO_CLOSING_QUOTE, line, g_filename);
-            goto terminate;
+            lexer_error(lexer, ERROR_NO_CLOSING_QUOTE);
+            token.type = TOKEN_ERROR;
+            token.length = (int)(p - token.lexeme);
+            break;
         }
+        token.type = TOKEN_STRING;
+        token.length = (int)(p - token.lexeme);
+        p++; // skip closing quote
 
-        token.lexeme[i] = '\0';
-        *input_ptr = p;
-        return token;
+        // A short string is also a character constant: mov al, 'A'
+        if (token.length <= (int)sizeof(token.value))
+            token.value = char_constant(token.lexeme, token.length);
+        break;
     }
 
-    // Number token (decimal or hex)
-    if ((*p >= '0' && *p <= '9') || (*p == '0' && (*(p + 1) == 'x' || *(p + 1) == 'X')))
-    {
-        int i = 0;
-        while ((*p >= '0' && *p <= '9') ||
-               (*p >= 'a' && *p <= 'f') ||
-               (*p >= 'A' && *p <= 'F') ||
-               *p == 'x' || *p == 'X')
-        {
-            if (i < (int)sizeof(token.lexeme) - 1)
-                token.lexeme[i++] = *p;
+    case CC_DIGIT:
+        // The whole alphanumeric run is the literal, so junk such as
+        // 0x0x1 or 12ab is rejected instead of split into two tokens
+        while (char_info(*p) & CH_NUMBER)
             p++;
-        }
-        token.lexeme[i] = '\0';
+        token.length = (int)(p - token.lexeme);
         token.type = TOKEN_NUMBER;
-        *input_ptr = p;
-        return token;
-    }
-
-    // Identifier, label, directive, instruction, or register
-    if ((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z') || *p == '_')
-    {
-        int i = 0;
-        while (((*p >= 'A' && *p <= 'Z') || (*p >= 'a' && *p <= 'z') ||
-                (*p >= '0' && *p <= '9') || *p == '_' || *p == '.'))
+        if (parse_number_view(token.lexeme, token.length, &token.value) != 0)
         {
-            if (i < (int)sizeof(token.lexeme) - 1)
-                token.lexeme[i++] = *p;
-            p++;
+            lexer_error(lexer, ERROR_INVALID_NUMBER);
+            token.type = TOKEN_ERROR;
         }
-        token.lexeme[i] = '\0';
+        break;
 
-        // Check if followed by colon => label
-        if (*p == ':')
-        {
+    case CC_ALPHA:
+        while (char_info(*p) & CH_IDENT)
             p++;
-            *input_ptr = p;
-            token.type = TOKEN_LABEL;
-            return token;
-        }
-
-        // Convert lexeme to uppercase for uniformity
-        char upper_lexeme[64];
-        strncpy(upper_lexeme, token.lexeme, sizeof(upper_lexeme) - 1);
-        upper_lexeme[sizeof(upper_lexeme) - 1] = '\0';
-        str_to_upper(upper_lexeme);
+        token.length = (int)(p - token.lexeme);
 
-        // Check if it's a register
-        TokenType reg_type = get_register_token_type(upper_lexeme);
-        if (reg_type != TOKEN_REG)
+        // Followed by a colon: a label, unless it is the segment
+        // register of an override like es:[bx]
+        if (*p == ':')
         {
-            token.type = reg_type;
-            if (token.type == TOKEN_REG8)
-            {
-                token.t_register8 = get_register8_by_name(upper_lexeme);
-                strcpy(token.lexeme, upper_lexeme);
-            }
-            if (token.type == TOKEN_REG16)
-            {
-                token.t_register16 = get_register16_by_name(upper_lexeme);
-                strcpy(token.lexeme, upper_lexeme);
-            }
-            /*
-            if (token.type == TOKEN_REG32)
-            {
-                token.t_register32 = get_register32_by_name(upper_lexeme);
-                strcpy(token.lexeme, upper_lexeme);
-            }
-            */
-            if (token.type == TOKEN_SEGREG)
+            const Keyword *keyword = token.length == 2 ? keyword_find(token.lexeme, 2) : NULL;
+            if (keyword == NULL || keyword->type != TOKEN_SEGREG)
             {
-                token.t_segregister = get_segment_register_by_name(upper_lexeme);
-                strcpy(token.lexeme, upper_lexeme);
+                token.type = TOKEN_LABEL;
+                p++;
+                break;
             }
-            // strcpy(token.lexeme, upper_lexeme);
         }
-        else
-        {
-            // Keywords and directives
-            if (strcmp(upper_lexeme, "SECTION") == 0)
-            {
-                token.type = TOKEN_SECTION;
-                strcpy(token.lexeme, upper_lexeme);
-            }
-            else if (strcmp(upper_lexeme, "DATA") == 0 || strcmp(upper_lexeme, "TEXT") == 0 || strcmp(upper_lexeme, "BSS") == 0)
-            {
-                token.type = TOKEN_SECTION_TYPE;
-                strcpy(token.lexeme, upper_lexeme);
-            }
-            else if (upper_lexeme[0] == '.')
-            {
-                token.type = TOKEN_DIRECTIVE;
-                strcpy(token.lexeme, upper_lexeme);
-            }
-            else
-            {
-                token.instr_type = INSTR_GENERIC;
-
-                InstructionType instr_type = get_instruction_type(upper_lexeme);
-                if (instr_type != INSTR_GENERIC)
-                {
-                    token.type = TOKEN_INSTR;
-                    token.instr_type = instr_type;
-                    strcpy(token.lexeme, upper_lexeme);
-                }
-
-                else
-                {
-                    token.type = TOKEN_INSTR;
-                    strcpy(token.lexeme, upper_lexeme);
-                }
-            }
-        }
-        *input_ptr = p;
-        return token;
+        classify_identifier(&token);
+        break;
+
+    case CC_ERROR:
+    case CC_SPACE:
+    default:
+        token.type = TOKEN_ERROR;
+        token.length = 1;
+        lexer_error(lexer, ERROR_UNKNOWN_TOKEN);
+        p++;
+        break;
     }
 
-    // Unknown token - report error
-    token.type = TOKEN_ERROR;
-    token.lexeme[0] = *p;
-    token.lexeme[1] = '\0';
-    occur_error(ERROR_UNKNOWN_TOKEN, line, g_filename);
-    p++;
-    *input_ptr = p;
+    lexer->cursor = p;
     return token;
+}
 
-terminate:
-    token.type = TOKEN_ERROR;
-    strcpy(token.lexeme, "ERROR");
-    *input_ptr = p;
-    return token;
+void lexer_init(Lexer *lexer, const char *source, size_t size, const char *file)
+{
+    lexer->cursor = source;
+    lexer->end = source + size;
+    lexer->line = 1;
+    lexer->line_has_tokens = 0;
+    lexer->filename = file;
+    lexer->report = NULL;
+    lexer->report_data = NULL;
 }
+
 /**
- * @brief Processes a line of code: extracts tokens and prints them.
+ * @brief Returns the next token and advances the line number after each TOKEN_EOL.
  *
- * @param line           The input line to parse, may start with "lineNumber~code".
- * @param file           The filename for error reporting.
- * @param line_number_ptr Pointer to current line number counter (will be incremented).
+ * The buffer is split into lines here: each '\n' produces a TOKEN_EOL. A
+ * last line without a trailing newline gets a TOKEN_EOL of its own.
  */
-void lexer_process_line(const char *line, const char *file, int *line_number_ptr)
+Token lexer_next(Lexer *lexer)
 {
-    // Check if line contains embedded line number (format: lineNum~code)
-    const char *tilde = strchr(line, '~');
-    int line_number = 0;
-
-    if (tilde)
+    if (lexer->cursor < lexer->end)
     {
-        char line_number_str[16];
-        int len = (int)(tilde - line);
-
-        if (len > (int)sizeof(line_number_str) - 1)
-            len = sizeof(line_number_str) - 1;
-
-        strncpy(line_number_str, line, (size_t)len);
-        line_number_str[len] = '\0';
-        line_number = atoi(line_number_str);
+        Token token = get_next_token(lexer);
 
-        // Move pointer to start of code after tilde
-        line = tilde + 1;
+        if (token.type != TOKEN_EOF)
+        {
+            if (token.type == TOKEN_EOL)
+            {
+                lexer->line++;
+                lexer->line_has_tokens = 0;
+            }
+            else
+            {
+                lexer->line_has_tokens = 1;
+            }
+            return token;
+        }
 
-        // If caller wants to keep track, update their line number
-        if (line_number_ptr)
-            *line_number_ptr = line_number + 1;
-    }
-    else if (line_number_ptr != NULL)
-    {
-        // Use caller's line number and increment it for next call
-        line_number = *line_number_ptr;
-        (*line_number_ptr)++;
-    }
-    else
-    {
-        // No line number info, default to 0
-        line_number = 0;
+        lexer->cursor = lexer->end; // a NUL byte inside the file ends the input
     }
 
-    // printf("Parsing line %d: %s\n", line_number, line); For lexer debugging
-    set_filename(file);
-
-    const char *code_ptr = line;
-
-    static char line_buffer[256] = ""; // To save line in it.
-
-    // Tokenize entire line
-    while (1)
+    Token token;
+    token.type = TOKEN_EOF;
+    token.instr_type = INSTR_GENERIC;
+    token.t_register8 = REG8_NONE;
+    token.t_register16 = REG16_NONE;
+    token.t_segregister = SEGREG_NONE;
+    token.value = 0;
+    token.symbol = 0;
+    token.line = lexer->line;
+    token.lexeme = lexer->cursor;
+    token.length = 0;
+
+    // The last line may not end with a newline
+    if (lexer->line_has_tokens)
     {
-        Token token = get_next_token(&code_ptr, &line_number);
-        
-
-        if (token.type == TOKEN_EOF)
-            break;
-
-        if (token.type == TOKEN_INSTR)
-        {
-            /*
-            printf("Token: %-12s Lexeme: %s\n",
-                   instruction_type_to_string(token.instr_type),
-                   token.lexeme);
-            */
-            snprintf(line_buffer, sizeof(line_buffer), "Token: %-12s Lexeme: %s\n",
-                     instruction_type_to_string(token.instr_type),
-                     token.lexeme);
-
-            parser_process_line(line_buffer);
-        }
-        else if (token.type == TOKEN_REG8)
-        {
-            /*
-            printf("Token: %-12s Lexeme: %s\n",
-                   reg8_type_to_string(token.t_register8),
-                   token.lexeme);
-            */
-            snprintf(line_buffer, sizeof(line_buffer), "Token: %-12s Lexeme: %s\n",
-                     reg8_type_to_string(token.t_register8),
-                     token.lexeme);
-
-            parser_process_line(line_buffer);
-        }
-        else if (token.type == TOKEN_REG16)
-        {
-            /*
-            printf("Token: %-12s Lexeme: %s\n",
-                   reg16_type_to_string(token.t_register16),
-                   token.lexeme);
-            */
-            snprintf(line_buffer, sizeof(line_buffer), "Token: %-12s Lexeme: %s\n",
-                     reg16_type_to_string(token.t_register16),
-                     token.lexeme);
-
-            parser_process_line(line_buffer);
-        }
-        // else if (token.type == TOKEN_REG32)
-        // {
-            /*
-            printf("Token: %-12s Lexeme: %s\n",
-                   reg32_type_to_string(token.t_register32),
-                   token.lexeme);
-            */
-           /*
-            snprintf(line_buffer, sizeof(line_buffer), "Token: %-12s Lexeme: %s\n",
-                     reg32_type_to_string(token.t_register32),
-                     token.lexeme);
-            parser_process_line(line_buffer);
-        */
-        // }
-        else if (token.type == TOKEN_SEGREG)
-        {
-            /*
-            printf("Token: %-12s Lexeme: %s\n",
-                   segreg_type_to_string(token.t_segregister),
-                   token.lexeme);
-            */
-            snprintf(line_buffer, sizeof(line_buffer), "Token: %-12s Lexeme: %s\n",
-                     segreg_type_to_string(token.t_segregister),
-                     token.lexeme);
-
-            parser_process_line(line_buffer);
-        }
-        else
-        {
-            /*
-            printf("Token: %-12s Lexeme: %s\n",
-                   token_type_to_string(token.type),
-                   token.lexeme);
-            */
-            snprintf(line_buffer, sizeof(line_buffer), "Token: %-12s Lexeme: %s\n",
-                     token_type_to_string(token.type),
-                     token.lexeme);
-
-            parser_process_line(line_buffer);
-        }
+        token.type = TOKEN_EOL;
+        lexer->line_has_tokens = 0;
     }
-    Token eol_token;
-    eol_token.type = TOKEN_EOL;
-    strcpy(eol_token.lexeme, "<EOL>");
-
-    /*
-    printf("Token: %-12s Lexeme: %s\n",
-       token_type_to_string(eol_token.type),
-       eol_token.lexeme);
-    */
-
-    snprintf(line_buffer, sizeof(line_buffer), "Token: %-12s Lexeme: %s\n",
-                     token_type_to_string(eol_token.type),
-                     eol_token.lexeme);
-
-    parser_process_line(line_buffer);
-
+    return token;
 }
 
 /**
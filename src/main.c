@@ -18,22 +18,29 @@
 
 // INCLUDE LIBRARIES HERE
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "include/proggrlinfo.h"
-#include "include/errors.h"
-#include "include/lexer.h"
+#include "include/stats.h"
+#include "include/assembler.h"
 
-// DEFINITIONS HERE
-#define MAX_LENGTH 256
+/**
+ * @brief Prints the command line syntax.
+ */
+static void print_usage(const char *program)
+{
+    fprintf(stderr, "Usage: %s [--stats] [-j N] [-o output|dir] [-l] <file|@response-file>...\n", program);
+}
 
 /**
  * @brief Entry point of the assembler program.
  *
- * This function reads an input file line-by-line, formats each line,
- * and passes it to the lexer for tokenization.
+ * This function reads the options and hands the input files to the
+ * assembly driver, which assembles them in parallel.
  *
  * @param argc Argument count.
- * @param argv Argument vector. The second argument (argv[1]) should be the input file name.
+ * @param argv Argument vector. Options (--stats, -j N, -o output|dir, -l) followed
+ *             by input files and @response files.
  * @return int Returns 0 on success, non-zero on error.
  */
 int main(int argc, char *argv[])
@@ -42,35 +49,58 @@ int main(int argc, char *argv[])
     printf("%s Copyright (C) %d %s\n", progName, progYear, progAuthor);
     printf("This program comes with ABSOLUTELY NO WARRANTY;\nThis is free software, and you are welcome to redistribute it\nunder certain conditions.\n\n");
 
-    // Ensure filename is provided
-    if (argc < 2)
+    int arg = 1;
+    int jobs = 0; // one worker thread per hardware thread
+    const char *output = NULL;
+    int listing = 0;
+
+    // Options before the file names
+    while (arg < argc && argv[arg][0] == '-')
     {
-        fprintf(stderr, "Usage: %s <string>\n", argv[0]);
-        return 1;
+        if (strcmp(argv[arg], "--stats") == 0)
+        {
+            stats_enable();
+            arg++;
+        }
+        else if (strcmp(argv[arg], "-j") == 0 && arg + 1 < argc)
+        {
+            char *end;
+            long value = strtol(argv[arg + 1], &end, 10);
+            if (*end != '\0' || value < 1 || value > 1024)
+            {
+                print_usage(argv[0]);
+                return 1;
+            }
+            jobs = (int)value;
+            arg += 2;
+        }
+        else if (strcmp(argv[arg], "-o") == 0 && arg + 1 < argc)
+        {
+            output = argv[arg + 1];
+            arg += 2;
+        }
+        else if (strcmp(argv[arg], "-l") == 0)
+        {
+            listing = 1;
+            arg++;
+        }
+        else
+        {
+            print_usage(argv[0]);
+            return 1;
+        }
     }
 
-    const char *filename = argv[1];
-    FILE *file = fopen(filename, "r");
-
-    // Handle file open failure
-    if (file == NULL)
+    // Ensure at least one filename is provided
+    if (arg >= argc)
     {
-        perror(ERROR_FILE_NOT_OPENED);
+        print_usage(argv[0]);
         return 1;
     }
 
-    char line[MAX_LENGTH];
-    int line_number = 1;
-
-    // Process each line in the input file
-    while (fgets(line, sizeof(line), file))
-    {
-        // Remove newline character if present
-        line[strcspn(line, "\n")] = '\0';
-
-        lexer_process_line(line, filename, &line_number);
-    }
+    // Without an output file the listing is the only result, so it is shown
+    int status = assemble_files((const char *const *)(argv + arg), argc - arg, jobs, output, listing || output == NULL);
 
-    fclose(file);
-    return 0;
+    stats_report();
+    return status;
 }
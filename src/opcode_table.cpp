@@ -17,109 +17,303 @@
 */
 
 #include "include/opcode_table.h"
-#include "include/errors.h"
+#include "include/asm_context.h"
+#include "include/encoder.h"
+#include "include/parser_handler.h"
 
-std::unordered_map<OperandKey, OpcodeInfo, OperandKeyHash> opcode_map;
-
-void init_opcode_table()
+/**
+ * @brief Builds the opcode table. Evaluated once, at compile time.
+ */
+static constexpr OpcodeTable build_opcode_table()
 {
-    //             mnemonic       op1                  op2                  opcode  modrm   imm  imm size ext
-    // MOV
-    opcode_map[{"MOV", OperandType::REG16, OperandType::IMM16}] = {0xB8, false, true, 2, 0};
-    opcode_map[{"MOV", OperandType::REG16, OperandType::REG16}] = {0x89, true, false, 0, 0};
-    opcode_map[{"MOV", OperandType::REG16, OperandType::MEM16}] = {0x8B, true, false, 0, 0};
-    opcode_map[{"MOV", OperandType::MEM16, OperandType::REG16}] = {0x89, true, false, 0, 0};
+    OpcodeTable t;
 
+    //     mnemonic    op1                  op2                   opcode  modrm   imm  imm size ext  branch
+    // MOV
+    t.add(INSTR_MOV, OperandType::REG16, OperandType::IMM16, {0xB8, false, true, 2, 0, BranchKind::NONE});
+    t.add(INSTR_MOV, OperandType::REG16, OperandType::REG16, {0x89, true, false, 0, 0, BranchKind::NONE});
+    t.add(INSTR_MOV, OperandType::REG16, OperandType::MEM16, {0x8B, true, false, 0, 0, BranchKind::NONE});
+    t.add(INSTR_MOV, OperandType::MEM16, OperandType::REG16, {0x89, true, false, 0, 0, BranchKind::NONE});
 
     // ADD r/m16, imm8 → Group 1, ext = 0
-    opcode_map[{"ADD", OperandType::REG16, OperandType::IMM8}] = {0x83, true, true, 1, 0};
-    opcode_map[{"ADD", OperandType::MEM16, OperandType::IMM8}] = {0x83, true, true, 1, 0};
+    t.add(INSTR_ADD, OperandType::REG16, OperandType::IMM8, {0x83, true, true, 1, 0, BranchKind::NONE});
+    t.add(INSTR_ADD, OperandType::MEM16, OperandType::IMM8, {0x83, true, true, 1, 0, BranchKind::NONE});
 
     // NOP
-    opcode_map[{"NOP", OperandType::NONE, OperandType::NONE}] = {0x90, false, false, 0, 0};
+    t.add(INSTR_NOP, OperandType::NONE, OperandType::NONE, {0x90, false, false, 0, 0, BranchKind::NONE});
+
+    // Relative branches to a label or address. JMP, Jcc and LOOP start as
+    // rel8; branch relaxation widens JMP and Jcc whose target is too far.
+    t.add(INSTR_JMP, OperandType::IMM16, OperandType::NONE, {0xEB, false, true, 1, 0, BranchKind::JMP});
+    t.add(INSTR_JE, OperandType::IMM16, OperandType::NONE, {0x74, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JZ, OperandType::IMM16, OperandType::NONE, {0x74, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JNE, OperandType::IMM16, OperandType::NONE, {0x75, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JNZ, OperandType::IMM16, OperandType::NONE, {0x75, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JB, OperandType::IMM16, OperandType::NONE, {0x72, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JAE, OperandType::IMM16, OperandType::NONE, {0x73, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JBE, OperandType::IMM16, OperandType::NONE, {0x76, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JA, OperandType::IMM16, OperandType::NONE, {0x77, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JS, OperandType::IMM16, OperandType::NONE, {0x78, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JNS, OperandType::IMM16, OperandType::NONE, {0x79, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JL, OperandType::IMM16, OperandType::NONE, {0x7C, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JGE, OperandType::IMM16, OperandType::NONE, {0x7D, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JLE, OperandType::IMM16, OperandType::NONE, {0x7E, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_JG, OperandType::IMM16, OperandType::NONE, {0x7F, false, true, 1, 0, BranchKind::JCC});
+    t.add(INSTR_LOOP, OperandType::IMM16, OperandType::NONE, {0xE2, false, true, 1, 0, BranchKind::LOOP});
+    t.add(INSTR_CALL, OperandType::IMM16, OperandType::NONE, {0xE8, false, true, 2, 0, BranchKind::CALL});
+
+    t.bind_encoders(form_encoder);
+    return t;
 }
 
-std::unordered_map<std::string, uint8_t> reg16_codes = {
-    {"AX", 0}, {"CX", 1}, {"DX", 2}, {"BX", 3}, {"SP", 4}, {"BP", 5}, {"SI", 6}, {"DI", 7}};
+constexpr OpcodeTable opcode_table = build_opcode_table();
 
-std::unordered_map<std::string, uint8_t> reg8_codes = {
-    {"AL", 0}, {"CL", 1}, {"DL", 2}, {"BL", 3}, {"AH", 4}, {"CH", 5}, {"DH", 6}, {"BH", 7}};
+/**
+ * @brief Segment override prefix byte of each SegmentRegister.
+ */
+static constexpr uint8_t segment_prefixes[] = {0x00, 0x2E, 0x3E, 0x36, 0x26, 0x64, 0x65};
+static_assert(sizeof(segment_prefixes) == SEGREG_GS + 1, "one prefix per SegmentRegister");
 
-std::unordered_map<std::string, uint8_t> seg_codes = {
-    {"CS", 0}, {"DS", 1}, {"SS", 2}, {"ES", 3}};
+/**
+ * @brief Row of each Register16 in ea_rm as a base register: 1 for BX, 2 for BP, 0 if it is not one.
+ */
+static constexpr uint8_t ea_base[] = {0, 0, 1, 0, 0, 0, 0, 2, 0};
+static_assert(sizeof(ea_base) == REG16_SP + 1, "one entry per Register16");
 
-ParsedOperand parseOperand(const std::vector<std::string> &tokens,
-                           const std::vector<std::string> &lexemes,
-                           size_t &idx)
+/**
+ * @brief Column of each Register16 in ea_rm as an index register: 1 for SI, 2 for DI, 0 if it is not one.
+ */
+static constexpr uint8_t ea_index[] = {0, 0, 0, 0, 0, 1, 2, 0, 0};
+static_assert(sizeof(ea_index) == REG16_SP + 1, "one entry per Register16");
+
+/**
+ * @brief ModR/M r/m field of each 8086 (base, index) pair.
+ *
+ * Neither base nor index is the direct [disp16] form, which shares
+ * r/m 110 with [BP] and is told apart by mod 00.
+ */
+static constexpr uint8_t ea_rm[3][3] = {
+    //  none   SI     DI
+    {0b110, 0b100, 0b101}, // none
+    {0b111, 0b000, 0b001}, // BX
+    {0b110, 0b010, 0b011}, // BP
+};
+
+/**
+ * @brief Chooses the ModR/M mod field of a memory operand from its displacement.
+ *
+ * @param direct True for [disp16] without base or index register.
+ * @param symbol True if a label is added, whose address pass 1 does not know yet.
+ * @param rm The r/m field.
+ * @param disp The numeric displacement.
+ */
+static constexpr uint8_t build_mod(bool direct, bool symbol, uint8_t rm, int16_t disp)
 {
-    ParsedOperand op;
+    if (direct)
+        return 0b00; // mod=00 & r/m=110 is [disp16]
+    if (symbol)
+        return 0b10; // always disp16, so the size does not depend on the label
+    // [BP] cannot be encoded with mod=00, so it gets a disp8 of 0
+    if (disp == 0 && rm != 0b110)
+        return 0b00;
+    return (disp >= -128 && disp <= 127) ? 0b01 : 0b10;
+}
 
-    if (tokens[idx].find("REG16") != std::string::npos)
+/**
+ * @brief Reads a label reference (name or .name) at tokens[idx] into op and advances idx past it.
+ */
+static void parse_symbol(const LineView &tokens, size_t &idx, ParsedOperand &op)
+{
+    op.symbol = true;
+    if (tokens[idx].type == TOKEN_INSTR)
     {
-        op.type = OperandType::REG16;
-        op.value = lexemes[idx];
-        auto it = reg16_codes.find(op.value);
-        if (it == reg16_codes.end())
-            fatal_error("Unknown REG16 ");
-        op.reg_code = it->second;
+        // A plain identifier names a label or EQU symbol; its value is filled in by pass 2
+        if (tokens[idx].instr_type != INSTR_GENERIC)
+            throw AssemblyError("Unknown operand type");
+        op.symbol_id = tokens[idx].symbol;
         idx++;
+        return;
     }
-    else if (tokens[idx].find("REG8") != std::string::npos)
+
+    // Local label reference like .loop
+    const TokenType next = tokens[idx + 1].type;
+    if (next == TOKEN_EOL || next == TOKEN_COMMA || next == TOKEN_CLOSE_BRACKET)
+        throw AssemblyError("Expected label name after '.'");
+    const Token &name = tokens[idx + 1];
+    if (name.type == TOKEN_LABEL || (name.type == TOKEN_INSTR && name.instr_type == INSTR_GENERIC))
+        op.symbol_id = name.symbol;
+    else
+        op.symbol_id = interner_find(&tokens.store->symbols, name.lexeme, static_cast<uint32_t>(name.length));
+    op.local = true;
+    idx += 2;
+}
+
+/**
+ * @brief Parses a memory operand from '[' to ']' and advances idx past it.
+ *
+ * The address is a sum of at most one base (BX, BP), one index (SI, DI),
+ * numbers and one label, with an optional segment override right after
+ * the '['. Base and index pick the r/m field and the displacement picks
+ * the mod field, straight from the tokens.
+ */
+static void parse_memory(const LineView &tokens, size_t &idx, ParsedOperand &op)
+{
+    const char *start = tokens[idx].lexeme + 1;
+    idx++;
+    if (tokens[idx].type == TOKEN_SEGREG && tokens[idx + 1].type == TOKEN_COLON)
     {
-        op.type = OperandType::REG8;
-        op.value = lexemes[idx];
-        auto it = reg8_codes.find(op.value);
-        if (it == reg8_codes.end())
-            fatal_error("Unknown REG8 ");
-        op.reg_code = it->second;
+        if (op.seg_prefix)
+            throw AssemblyError("More than one segment override in memory operand");
+        op.seg_prefix = segment_prefixes[tokens[idx].t_segregister];
+        idx += 2;
+    }
+
+    uint8_t base = 0;
+    uint8_t index = 0;
+    long disp = 0;
+    bool negate = false;
+    if (tokens[idx].type == TOKEN_MINUS)
+    {
+        negate = true;
         idx++;
     }
-    else if (tokens[idx].find("SEG") != std::string::npos)
+    for (;;)
     {
-        op.type = OperandType::SEGREG;
-        op.value = lexemes[idx];
-        auto it = seg_codes.find(op.value);
-        if (it == seg_codes.end())
-            fatal_error("Unknown segment register ");
-        op.seg_code = it->second;
+        const Token term = tokens[idx];
+        switch (term.type)
+        {
+        case TOKEN_REG16:
+        {
+            const uint8_t as_base = ea_base[term.t_register16];
+            const uint8_t as_index = ea_index[term.t_register16];
+            if (negate || (!as_base && !as_index))
+                throw AssemblyError("Invalid register in memory operand");
+            if ((as_base && base) || (as_index && index))
+                throw AssemblyError("Too many registers in memory operand");
+            base = as_base ? as_base : base;
+            index = as_index ? as_index : index;
+            idx++;
+            break;
+        }
+        case TOKEN_NUMBER:
+            disp += negate ? -term.value : term.value;
+            idx++;
+            break;
+        case TOKEN_INSTR:
+        case TOKEN_DOT:
+            if (negate || op.symbol)
+                throw AssemblyError("Only one label can be added in a memory operand");
+            parse_symbol(tokens, idx, op);
+            break;
+        case TOKEN_EOL:
+            throw AssemblyError("Unmatched [ in memory operand");
+        default:
+            throw AssemblyError("Invalid term in memory operand");
+        }
+
+        const TokenType next = tokens[idx].type;
+        if (next == TOKEN_CLOSE_BRACKET)
+            break;
+        if (next == TOKEN_EOL)
+            throw AssemblyError("Unmatched [ in memory operand");
+        if (next != TOKEN_PLUS && next != TOKEN_MINUS)
+            throw AssemblyError("Expected + or - in memory operand");
+        negate = next == TOKEN_MINUS;
         idx++;
     }
-    else if (tokens[idx].find("NUMBER") != std::string::npos)
+    if (disp < -32768 || disp > 0xFFFF)
+        throw AssemblyError("Displacement out of range in memory operand");
+
+    op.type = OperandType::MEM16;
+    op.value = std::string_view(start, static_cast<size_t>(tokens[idx].lexeme - start));
+    op.displacement = static_cast<int16_t>(static_cast<uint16_t>(disp & 0xFFFF));
+    op.modrm_rm = ea_rm[base][index];
+    op.modrm_mod = build_mod(!base && !index, op.symbol, op.modrm_rm, op.displacement);
+    idx++;
+}
+
+ParsedOperand parseOperand(const LineView &tokens,
+                           size_t &idx)
+{
+    ParsedOperand op{OperandType::NONE, {}, 0, REG8_NONE, REG16_NONE, SEGREG_NONE, 0, 0, 0, 0, false, 0, false};
+
+    switch (tokens[idx].type)
     {
-        op.type = OperandType::IMM16;
-        op.value = lexemes[idx];
+    case TOKEN_REG16:
+    {
+        op.type = OperandType::REG16;
+        op.value = token_text(tokens[idx]);
+        op.reg16 = tokens[idx].t_register16;
         idx++;
+        break;
     }
-    else if (tokens[idx] == "OPEN_BRACKET")
+    case TOKEN_REG8:
     {
+        op.type = OperandType::REG8;
+        op.value = token_text(tokens[idx]);
+        op.reg8 = tokens[idx].t_register8;
         idx++;
-        std::string mem_expr;
-        while (idx < tokens.size() && tokens[idx] != "CLOSING_BRACKET")
+        break;
+    }
+    case TOKEN_SEGREG:
+    {
+        if (tokens[idx + 1].type == TOKEN_COLON)
         {
-            mem_expr += lexemes[idx];
-            idx++;
+            // Segment override in front of a memory operand: es:[di]
+            op.seg_prefix = segment_prefixes[tokens[idx].t_segregister];
+            idx += 2;
+            if (tokens[idx].type != TOKEN_OPEN_BRACKET)
+                throw AssemblyError("Expected memory operand after segment override");
+            parse_memory(tokens, idx, op);
+            break;
         }
-        if (idx == tokens.size())
-            fatal_error("Unmatched [ in memory operand");
+        op.type = OperandType::SEGREG;
+        op.value = token_text(tokens[idx]);
+        op.segreg = tokens[idx].t_segregister;
         idx++;
-        op.type = OperandType::MEM16;
-        op.value = mem_expr;
+        break;
     }
-    else if (tokens[idx] == "CHAR")
+    case TOKEN_NUMBER:
+        // Sized from the value, so the imm8 forms (add ax, 5) can match
+        op.type = get_operand_type_from_token(tokens[idx]);
+        op.value = token_text(tokens[idx]);
+        op.imm = tokens[idx].value;
+        idx++;
+        break;
+    case TOKEN_OPEN_BRACKET:
+        parse_memory(tokens, idx, op);
+        break;
+    case TOKEN_INSTR:
+    case TOKEN_DOT:
     {
+        const char *start = tokens[idx].lexeme;
+        parse_symbol(tokens, idx, op);
+        const Token &last = tokens[idx - 1];
+        op.type = OperandType::IMM16;
+        op.value = std::string_view(start, static_cast<size_t>(last.lexeme + last.length - start));
+        break;
+    }
+    case TOKEN_CHAR:
         op.type = OperandType::CHAR;
-        op.value = lexemes[idx];
+        op.value = token_text(tokens[idx]);
         idx++;
-    }
-    else if (tokens[idx] == "STRING")
-    {
-        op.type = OperandType::STRING;
-        op.value = lexemes[idx];
+        break;
+    case TOKEN_STRING:
+        // 'A' or 'ab' is a character constant; the lexer already packed its value
+        if (tokens[idx].length >= 1 && tokens[idx].length <= 2)
+        {
+            op.type = OperandType::IMM16;
+            op.imm = tokens[idx].value;
+        }
+        else
+        {
+            op.type = OperandType::STRING;
+        }
+        op.value = token_text(tokens[idx]);
         idx++;
-    }
-    else
-    {
-        fatal_error("Unknown operand type");
+        break;
+    default:
+        throw AssemblyError("Unknown operand type");
     }
 
     return op;
@@ -18,94 +18,369 @@
 
 #include "include/parser.h"
 #include "include/parser_handler.h"
+#include "include/stats.h"
+#include "include/line_view.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <memory>
 #include <string>
-#include <sstream>
-#include <iostream>
+#include <thread>
+#include <utility>
 #include <vector>
 
-std::vector<Token> tokens;
-std::vector<std::string> tokens_in_line;
-std::vector<std::string> lexemes_in_line;
+// Lines handed to one pass-1 thread at a time; smaller files are parsed on one thread
+static const size_t PARSE_CHUNK_MIN = 8192;
 
 /**
- * @brief Processes a Token object by storing its type and lexeme, and handling line completion.
- * 
- * This function ignores tokens of type "COMMENT". For other tokens, it stores their
- * type and lexeme in vectors representing the current line. When an "EOL" (end of line)
- * token is encountered, it calls the handler for the collected tokens of the line,
- * unless the line is empty (only contains EOL). Afterwards, it resets the line vectors.
- * 
- * @param token The Token object to process.
+ * @brief A run of lines parsed on its own, or a single line that needs $.
  */
-void parse_token_and_lexeme(const Token& token) {
-    // Skip comments completely
-    if (token.type == "COMMENT") {
-        return;
+struct ParsePiece {
+    size_t first = 0;      /**< First line of the piece. */
+    size_t last = 0;       /**< One past the last line. */
+    bool serial = false;   /**< A single line the scan parses with the real location counter. */
+    std::unique_ptr<AsmContext> part; /**< What the lines define, with addresses counted from zero. */
+    size_t failed_line = 0; /**< Line that stopped the piece, if it failed. */
+    std::string error;     /**< Message of the exception that stopped the piece. */
+    bool failed = false;
+
+    int start = 0;         /**< Address of the piece, set by the scan. */
+    uint32_t scope = 0;    /**< Label scope at the start of the piece, set by the scan. */
+    size_t ir_base = 0;    /**< Index of the first IR instruction of the piece. */
+    uint32_t expr_base = 0; /**< Index of the first IR expression of the piece. */
+};
+
+/**
+ * @brief Returns the tokens of a line of the token store.
+ */
+static LineView collected_line(const AsmContext &ctx, size_t line) {
+    const TokenStore &store = ctx.tokens;
+    const size_t first = line ? store.line_ends[line - 1] : 0;
+    return LineView{&store, first, store.line_ends[line] - first, static_cast<int>(store.line_numbers[line])};
+}
+
+/**
+ * @brief Writes the held lexer errors found before the given token index.
+ * A file with a lexer error has failed, even if every line assembles.
+ *
+ * @param reported Number of errors written so far; advanced past the ones written now.
+ */
+static void report_lexer_errors(AsmContext &ctx, size_t &reported, size_t token_end) {
+    while (reported < ctx.lexer_errors.size() && ctx.lexer_errors[reported].first < token_end) {
+        ctx.out << ctx.lexer_errors[reported++].second;
+        ctx.failed = true;
     }
+}
+
+/**
+ * @brief Returns true if a line reads or sets the location counter, so it
+ * cannot be parsed before the address of everything above it is known.
+ */
+static bool needs_location(const LineView &line) {
+    if (line[0].type != TOKEN_INSTR) {
+        return false;
+    }
+    switch (line[0].instr_type) {
+    case DIRECTIVE_ORG:
+    case DIRECTIVE_BITS:
+        return true;
+    case DIRECTIVE_TIMES:
+        for (size_t i = 0; i < line.size(); i++) {
+            if (token_text(line[i]).find('$') != std::string_view::npos) {
+                return true;
+            }
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Runs a function on every piece that is not serial, on up to the given number of threads.
+ */
+template <typename Function>
+static void for_each_piece(std::vector<ParsePiece> &pieces, size_t threads, Function function) {
+    std::atomic<size_t> next{0};
+    auto worker = [&]() {
+        for (size_t i = next.fetch_add(1, std::memory_order_relaxed); i < pieces.size();
+             i = next.fetch_add(1, std::memory_order_relaxed)) {
+            if (!pieces[i].serial) {
+                function(pieces[i]);
+            }
+        }
+    };
 
-    // Store the token type and lexeme for the current line
-    tokens_in_line.push_back(token.type);
-    lexemes_in_line.push_back(token.lexeme);
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t t = 1; t < threads; t++) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread &thread : pool) {
+        thread.join();
+    }
+}
 
-    // On end-of-line token, handle the accumulated line tokens
-    if (token.type == "EOL") {
-        // Determine if the line contains only EOL (empty line)
-        bool only_eol = (tokens_in_line.size() == 1 && tokens_in_line[0] == "EOL");
+/**
+ * @brief Makes room for what pass 1 makes of the given number of lines.
+ *
+ * A line gives at most one instruction, expression and label. Vectors that
+ * grow in the arena leave their old buffers behind, so they are sized once
+ * up front; the pages of the room that is never used cost no memory.
+ */
+static void reserve_ir(AsmContext &ctx, size_t lines) {
+    ctx.ir.reserve(lines);
+    ctx.ir_exprs.reserve(lines);
+    ctx.label_defs.reserve(lines);
+}
 
-        if (!only_eol) {
-            // Process tokens and lexemes for the current line
-            handle_parse(tokens_in_line, lexemes_in_line);
+/**
+ * @brief Parses the lines of a piece into its own context.
+ */
+static void parse_piece(const AsmContext &ctx, ParsePiece &piece) {
+    stats_phase_begin(STATS_PHASE_PARSE);
+    piece.part = std::make_unique<AsmContext>();
+    piece.part->label_scope = LABEL_SCOPE_INHERITED;
+    reserve_ir(*piece.part, piece.last - piece.first);
+    size_t line = piece.first;
+    try {
+        for (; line < piece.last; line++) {
+            handle_parse(*piece.part, collected_line(ctx, line));
+            stats_count_line();
         }
+    } catch (const std::exception &ex) {
+        piece.failed = true;
+        piece.failed_line = line;
+        piece.error = ex.what();
+    }
+    stats_phase_end(STATS_PHASE_PARSE);
+}
 
-        // Clear vectors to prepare for the next line
-        tokens_in_line.clear();
-        lexemes_in_line.clear();
+/**
+ * @brief Moves the IR of a piece to its place in the context, shifted to its address.
+ */
+static void place_piece(AsmContext &ctx, ParsePiece &piece) {
+    IrInstr *dest = ctx.ir.data() + piece.ir_base;
+    for (IrInstr instr : piece.part->ir) {
+        instr.address += static_cast<uint32_t>(piece.start);
+        if (instr.expr) {
+            instr.expr += piece.expr_base;
+        }
+        *dest++ = instr;
+    }
+    for (IrExpr &expr : piece.part->ir_exprs) {
+        if (expr.scope == LABEL_SCOPE_INHERITED) {
+            expr.scope = piece.scope;
+        }
     }
+    std::move(piece.part->ir_exprs.begin(), piece.part->ir_exprs.end(), ctx.ir_exprs.begin() + piece.expr_base);
+    piece.part.reset();
 }
 
 /**
- * @brief Parses a single input line representing a token and extracts its type and lexeme.
- * 
- * The expected input format is:
- * 
- *     Token: <TOKEN_TYPE> Lexeme: <LEXEME>
- * 
- * This function reads the input line, extracts the token type and lexeme, removes any
- * trailing colons from keys, and constructs a Token object. It then forwards the Token
- * to the parser for processing.
- * 
- * @param token_line A C-string representing a single lexer output line.
+ * @brief Fills the label and symbol tables from the definitions pass 1 recorded.
+ *
+ * A name defined twice keeps its last definition; so does a local label
+ * defined twice in the same scope.
  */
-void parser_process_line(const char *token_line) {
-    std::string line(token_line);
-    std::istringstream iss(line);
+static void build_symbol_tables(AsmContext &ctx) {
+    const size_t symbols = ctx.tokens.symbols.count;
+    ctx.label_table.assign(symbols, IrLabel{});
+    for (const auto &def : ctx.label_defs) {
+        ctx.label_table[def.first] = def.second;
+    }
+    ctx.symbol_table.assign(symbols, IrSymbol{});
+    for (const auto &def : ctx.symbol_defs) {
+        ctx.symbol_table[def.first] = def.second;
+    }
+
+    // One hash table per scope for its local labels; see AsmContext::local_labels
+    ctx.local_label_first.assign(symbols + 2, 0);
+    for (const IrLocalLabel &local : ctx.local_label_defs) {
+        ctx.local_label_first[local.scope + 1]++;
+    }
+    for (size_t scope = 1; scope < ctx.local_label_first.size(); scope++) {
+        const uint32_t count = ctx.local_label_first[scope];
+        uint32_t size = count ? 2 : 0;
+        while (size < 2 * count) {
+            size *= 2;
+        }
+        ctx.local_label_first[scope] = ctx.local_label_first[scope - 1] + size;
+    }
+    ctx.local_labels.assign(ctx.local_label_first.back(), IrLocalLabel{});
+    for (const IrLocalLabel &local : ctx.local_label_defs) {
+        ctx.local_labels[local_label_slot(ctx, local.scope, local.name)] = local;
+    }
+
+    // func.loop names the local label .loop of func from anywhere, unless
+    // the whole name is a label or EQU of its own. It gets a copy of the
+    // local label, which branch relaxation moves the same way.
+    for (uint32_t symbol = 0; symbol < symbols; symbol++) {
+        if (ctx.label_table[symbol].defined || ctx.symbol_table[symbol].defined) {
+            continue;
+        }
+        const std::string_view name = symbol_name(ctx.tokens, symbol);
+        const size_t dot = name.find('.', 1);
+        if (dot == std::string_view::npos) {
+            continue;
+        }
+        const uint32_t scope = interner_find(&ctx.tokens.symbols, name.data(), static_cast<uint32_t>(dot));
+        const uint32_t local = interner_find(&ctx.tokens.symbols, name.data() + dot + 1,
+                                             static_cast<uint32_t>(name.size() - dot - 1));
+        if (scope == INTERNER_NO_ID || local == INTERNER_NO_ID) {
+            continue;
+        }
+        const IrExpr expr{local, scope + 1, true, false};
+        if (const IrLabel *label = find_label(ctx, expr)) {
+            ctx.label_table[symbol] = *label;
+        }
+    }
 
-    std::string key1, token_type, key2, lexeme;
+    ctx.label_defs.clear();
+    ctx.local_label_defs.clear();
+    ctx.symbol_defs.clear();
+}
 
-    // Extract keys and values from the input line
-    iss >> key1 >> token_type >> key2;
+/**
+ * @brief Pass 1 on this thread: every line in order, straight into the context.
+ */
+static void parse_lines_in_order(AsmContext &ctx) {
+    const size_t lines = ctx.tokens.line_count;
+    size_t reported = 0;
+    size_t line = 0;
+    stats_phase_begin(STATS_PHASE_PARSE);
+    reserve_ir(ctx, lines);
+    try {
+        for (; line < lines; line++) {
+            handle_parse(ctx, collected_line(ctx, line));
+            stats_count_line();
+        }
+    } catch (const std::exception &) {
+        stats_phase_end(STATS_PHASE_PARSE);
+        report_lexer_errors(ctx, reported, ctx.tokens.line_ends[line]);
+        throw;
+    }
+    stats_phase_end(STATS_PHASE_PARSE);
+    report_lexer_errors(ctx, reported, ctx.tokens.count);
+    ctx.lexer_errors.clear();
+    build_symbol_tables(ctx);
+}
 
-    // Extract the rest of the line as lexeme (may contain spaces)
-    std::getline(iss, lexeme);
-    if (!lexeme.empty() && lexeme[0] == ' ') {
-        lexeme.erase(0, 1);
+void parser_process_lines(AsmContext &ctx, size_t threads) {
+    const size_t lines = ctx.tokens.line_count;
+    if (threads <= 1 || lines <= PARSE_CHUNK_MIN) {
+        parse_lines_in_order(ctx);
+        return;
     }
+    const size_t target = std::max(PARSE_CHUNK_MIN, (lines + threads - 1) / threads);
 
-    // Remove trailing colons from keys (e.g., "Token:" -> "Token")
-    if (!key1.empty() && key1.back() == ':') {
-        key1.pop_back();
+    std::vector<ParsePiece> pieces;
+    size_t first = 0;
+    for (size_t line = 0; line < lines; line++) {
+        const bool serial = needs_location(collected_line(ctx, line));
+        if (serial || line + 1 - first == target) {
+            if (first < line + (serial ? 0 : 1)) {
+                pieces.emplace_back();
+                pieces.back().first = first;
+                pieces.back().last = line + (serial ? 0 : 1);
+            }
+            if (serial) {
+                pieces.emplace_back();
+                pieces.back().first = line;
+                pieces.back().last = line + 1;
+                pieces.back().serial = true;
+            }
+            first = line + 1;
+        }
     }
-    if (!key2.empty() && key2.back() == ':') {
-        key2.pop_back();
+    if (first < lines) {
+        pieces.emplace_back();
+        pieces.back().first = first;
+        pieces.back().last = lines;
     }
 
-    // Output token type and lexeme for debugging
-    // std::cout << "Token type: " << token_type << ", Lexeme: " << lexeme << std::endl;
+    const size_t parallel = static_cast<size_t>(std::count_if(pieces.begin(), pieces.end(),
+                                                              [](const ParsePiece &piece) { return !piece.serial; }));
+    const size_t workers = std::max<size_t>(1, std::min(threads, parallel));
+    for_each_piece(pieces, workers, [&ctx](ParsePiece &piece) { parse_piece(ctx, piece); });
+
+    // Lexer errors come out up to the line pass 1 stops at, as when parsing while lexing
+    size_t reported = 0;
+
+    // The scan: each piece starts where the one before it ends
+    stats_phase_begin(STATS_PHASE_PARSE);
+    reserve_ir(ctx, lines);
+    for (ParsePiece &piece : pieces) {
+        if (piece.serial) {
+            try {
+                handle_parse(ctx, collected_line(ctx, piece.first));
+                stats_count_line();
+            } catch (const std::exception &) {
+                stats_phase_end(STATS_PHASE_PARSE);
+                report_lexer_errors(ctx, reported, ctx.tokens.line_ends[piece.first]);
+                throw;
+            }
+            continue;
+        }
+
+        AsmContext &part = *piece.part;
+        piece.start = ctx.location_counter;
+        piece.scope = ctx.label_scope;
+        piece.ir_base = ctx.ir.size();
+        piece.expr_base = static_cast<uint32_t>(ctx.ir_exprs.size());
+        const uint32_t barriers = static_cast<uint32_t>(ctx.ir_barriers.size());
+
+        // Definitions stay in source order, so later ones still win in build_symbol_tables()
+        for (auto &def : part.label_defs) {
+            IrLabel &label = def.second;
+            label.address += piece.start;
+            label.anchor += static_cast<uint32_t>(piece.ir_base);
+            label.barrier = barriers;
+            ctx.label_defs.push_back(def);
+        }
+        for (IrLocalLabel local : part.local_label_defs) {
+            if (local.scope == LABEL_SCOPE_INHERITED) {
+                local.scope = piece.scope;
+            }
+            local.label.address += piece.start;
+            local.label.anchor += static_cast<uint32_t>(piece.ir_base);
+            local.label.barrier = barriers;
+            ctx.local_label_defs.push_back(local);
+        }
+        if (part.label_scope != LABEL_SCOPE_INHERITED) {
+            ctx.label_scope = part.label_scope;
+        }
+        for (const auto &def : part.symbol_defs) {
+            ctx.symbol_defs.push_back(def);
+        }
+        for (IrData data : part.ir_data) {
+            data.address += piece.start;
+            data.anchor += static_cast<uint32_t>(piece.ir_base);
+            data.barrier = barriers;
+            data.bytes = ctx.arena.keep(data.bytes);
+            ctx.ir_data.push_back(data);
+        }
+        if (part.diagnostics.tellp() > 0) {
+            ctx.diagnostics << part.diagnostics.str();
+        }
+
+        if (piece.failed) {
+            stats_phase_end(STATS_PHASE_PARSE);
+            report_lexer_errors(ctx, reported, ctx.tokens.line_ends[piece.failed_line]);
+            throw AssemblyError(piece.error);
+        }
+
+        ctx.location_counter += part.location_counter;
+        ctx.ir.resize(ctx.ir.size() + part.ir.size());
+        ctx.ir_exprs.resize(ctx.ir_exprs.size() + part.ir_exprs.size());
+    }
+    report_lexer_errors(ctx, reported, ctx.tokens.count);
 
-    // Construct Token and forward for parsing
-    Token current;
-    current.type = token_type;
-    current.lexeme = lexeme;
+    for_each_piece(pieces, workers, [&ctx](ParsePiece &piece) { place_piece(ctx, piece); });
+    build_symbol_tables(ctx);
+    stats_phase_end(STATS_PHASE_PARSE);
 
-    parse_token_and_lexeme(current);
+    ctx.lexer_errors.clear();
 }
@@ -18,10 +18,10 @@
 
 #include "include/parser_handler.h"
 #include "include/opcode_table.h"
-#include "include/errors.h"
-#include <iostream>
-#include <unordered_map>
+#include "include/encoder.h"
+#include "include/stats.h"
 #include <string>
+#include <utility>
 #include <vector>
 #include <cctype>
 #include <cstdlib>
@@ -31,453 +31,414 @@
 #include <stdexcept>
 #include <functional>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <thread>
+#include <memory>
 
 #define likely(x) __builtin_expect(!!(x), 1)
 #define unlikely(x) __builtin_expect(!!(x), 0)
 
-//                  label name  address
-std::unordered_map<std::string, int> label_table;
-//                   symbol name     value
-std::unordered_map<std::string, std::string> symbol_table;
-
-extern const std::unordered_map<std::string, int> no_operand_instructions;
-extern const std::unordered_map<std::string, int> one_operand_instructions;
-extern const std::unordered_map<std::string, int> two_operand_instructions;
-
-int current_bits_mode = 16;    // EASM only supports 16 bit real mode, so this line is a guarantee
-int location_counter = 0;      // $$
-int base_location_counter = 0; // for saving ORG directive and $
-int *lcPointer = &location_counter;
-int *blcPointer = &base_location_counter;
+/**
+ * @brief Returns the element size in bytes of a data definition directive.
+ *
+ * @param defineSize DIRECTIVE_DB, DIRECTIVE_DW or DIRECTIVE_DD.
+ * @return int Element size in bytes, or 0 for unsupported directives.
+ */
+int incByte(InstructionType defineSize)
+{
+    switch (defineSize)
+    {
+    case DIRECTIVE_DB:
+        return 1;
+    case DIRECTIVE_DW:
+        return 2;
+    case DIRECTIVE_DD:
+        return 4;
+    default:
+        return 0; // for unsupported ones (code crash maybe)
+    }
+}
 
-static std::string toUpperStr(const std::string &s)
+/**
+ * @brief Returns true if the token is a data definition directive (DB, DW or DD).
+ */
+static bool is_define_directive(const Token &token)
 {
-    std::string out;
-    out.reserve(s.size());
-    for (char c : s)
-        out.push_back((char)std::toupper((unsigned char)c));
-    return out;
+    return token.type == TOKEN_INSTR && incByte(token.instr_type) != 0;
 }
 
-inline int stringToInt(std::string str)
+/**
+ * @brief Returns a label at the current location counter.
+ */
+static IrLabel label_here(const AsmContext &ctx)
 {
-    return stoi(str);
+    return IrLabel{ctx.location_counter, static_cast<uint32_t>(ctx.ir.size()),
+                   static_cast<uint32_t>(ctx.ir_barriers.size()), true};
 }
 
-int incByte(const std::string &defineSize)
+/**
+ * @brief Defines a non-local label at the current location counter; the
+ * local labels after it belong to it.
+ */
+static void define_label(AsmContext &ctx, uint32_t symbol)
 {
-    static const std::unordered_map<std::string, int> sizeMap{
-        {"DB", 1},
-        {"DW", 2},
-        {"DD", 4}};
+    ctx.label_defs.emplace_back(symbol, label_here(ctx));
+    ctx.label_scope = symbol + 1;
+}
 
-    auto it = sizeMap.find(defineSize);
-    if (it != sizeMap.end())
-    {
-        return it->second;
-    }
-    return 0; // for unsupported ones (code crash maybe)
+/**
+ * @brief Defines a local label (.name) in the scope of the last non-local label.
+ */
+static void define_local_label(AsmContext &ctx, uint32_t name)
+{
+    ctx.local_label_defs.push_back(IrLocalLabel{ctx.label_scope, name, label_here(ctx)});
 }
 
-int countBytesInHexString(const std::string &hexStr)
+/**
+ * @brief Gives a name the value of an EQU.
+ */
+static void define_symbol(AsmContext &ctx, uint32_t symbol, const IrSymbol &value)
 {
-    if (hexStr.empty())
-        return 0;
-    std::istringstream iss(hexStr);
-    int count = 0;
-    std::string byteStr;
-    while (iss >> byteStr)
-    {
-        count++;
-    }
-    return count;
+    ctx.symbol_defs.emplace_back(symbol, value);
 }
 
 /**
- * @brief Main parsing handler for processing tokenized assembly input.
+ * @brief Returns the value of "name EQU value": a number, a negated
+ * number, or another name that is looked up when the symbol is used.
  *
- * This function supports label detection and storage, directive handling,
- * and instruction parsing including operand type resolution and opcode lookup.
- *
- * @param token_vector Vector of token strings representing types (e.g., "INSTR_MOV", "REG16_AX").
- * @param lexeme_vector Vector of lexeme strings representing the original text (e.g., "MOV", "AX").
+ * @param line Tokens of the line, ending with TOKEN_EOL.
  */
-void handle_parse(std::vector<std::string> token_vector, std::vector<std::string> lexeme_vector)
+static IrSymbol equ_value(const LineView &line)
 {
-    /* FOR DEBUGGING
-    for(const auto& t : token_vector){
-        std::cout << "Token: \n" << t << std::endl;
-    }
+    IrSymbol symbol{true, 0, 0};
+    size_t i = 2;
+    if (line[i].type == TOKEN_EOL)
+        throw AssemblyError("EQU directive missing value");
+
+    if (line[i].type == TOKEN_MINUS && line[i + 1].type == TOKEN_NUMBER)
+        symbol.value = -line[++i].value;
+    else if (line[i].type == TOKEN_NUMBER)
+        symbol.value = line[i].value;
+    else if (line[i].type == TOKEN_INSTR && line[i].instr_type == INSTR_GENERIC)
+        symbol.alias = line[i].symbol + 1;
+    else
+        throw AssemblyError("Unsupported EQU value: " + std::string(token_text(line[i])));
+
+    if (line[i + 1].type != TOKEN_EOL)
+        throw AssemblyError("EQU takes a single value");
+    // EQU values end up in imm16 operands and 16-bit displacements
+    if (symbol.value < IMM16_MIN || symbol.value > IMM16_MAX)
+        throw AssemblyError("EQU value out of 16-bit range: " + std::string(token_text(line[i])));
+    return symbol;
+}
 
-    for(const auto& l : lexeme_vector){
-        std::cout << "Lexeme: \n" << l << std::endl;
-    }
-    */
+/**
+ * @brief Returns how many bytes DB, DW or DD gives one operand: a string
+ * is rounded up to a whole number of units.
+ */
+static size_t data_size(const Token &operand, int byteSize)
+{
+    if (operand.type == TOKEN_STRING)
+        return static_cast<size_t>((operand.length + byteSize - 1) / byteSize * byteSize);
+    return static_cast<size_t>(byteSize);
+}
 
-    if (token_vector[0].find("DIRECTIVE_") == 0) // handle directives first
+/**
+ * @brief Writes the bytes of one DB, DW or DD operand: a number in
+ * byteSize bytes, low byte first, or the characters of a string as they
+ * are, zero-padded to a whole number of units (dw 'abc' is 61 62 63 00).
+ *
+ * @return char* The byte after the last one written.
+ */
+static char *put_data(char *dest, const Token &operand, int byteSize)
+{
+    if (operand.type == TOKEN_STRING)
     {
-        if (token_vector[0] == "DIRECTIVE_BITS")
-        {
-            current_bits_mode = stringToInt(lexeme_vector[1]); // BITS 16
-        }
-        else if (token_vector[0] == "DIRECTIVE_ORG")
-        {
-            *lcPointer = stringToHexNumber(lexeme_vector[1]);
-            *blcPointer = *lcPointer;
-        }
-        else if (token_vector[0] == "DIRECTIVE_DB" || token_vector[0] == "DIRECTIVE_DW" || token_vector[0] == "DIRECTIVE_DD") // handle if define x directives come first
-        {
-            int byteSize = incByte(token_vector[0].substr(10)); // substr(10) = DIRECTIVE_DB -> DB
-            if (token_vector.size() > 1)                        // check for syntax error
-            {
-                if (token_vector[1] == "STRING")
-                {
-                    std::string hexString = stringToHexInString(lexeme_vector[1]);
-                    int bytesCount = countBytesInHexString(hexString); // "Hello" becomes "H" "E" "L" "L" "O" and each character has one byte (does not count null terminator \0)
-                    *lcPointer += bytesCount * byteSize;               // if db <string> then for each char, char * byte. this applies for dw and dd too.
-                }
-                else if (token_vector[1] == "NUMBER") // for example, dw 0xAA55
-                {
-                    *lcPointer += byteSize;
-                }
-                else // how can we come here
-                {
-                    fatal_error("UNKNOWN ERROR HAPPENED");
-                }
-            }
-        }
-        else if (token_vector[0] == "DIRECTIVE_EQU")
-        {
-            fatal_error("DIRECTIVE EQU CANNOT BE USED WITHOUT VARIABLE NAME"); // "MAXLEN equ 64" is OK.  "equ 64" is wrong
-        }
-        else if (token_vector[0] == "DIRECTIVE_ALIGN")
-        {
-            int alignVal = stringToInt(lexeme_vector[1]);
-            align_address(*lcPointer, alignVal);
-        }
-        else if (token_vector[0] == "DIRECTIVE_TIMES")
-        {
+        const size_t size = data_size(operand, byteSize);
+        std::memcpy(dest, operand.lexeme, static_cast<size_t>(operand.length));
+        std::memset(dest + operand.length, 0, size - static_cast<size_t>(operand.length));
+        return dest + size;
+    }
 
-            int repeatCount = 0;
-            int dataValue = 0;
-            //                                                        full expression
-            //                                             code start@----------------|
-            // collect full expression after times (up to db) // times 510 - ($ - $$) db 0 // bootloader example
-            std::string expr;
-            size_t i = 1;
-            for (; i < lexeme_vector.size(); ++i)
-            {
-                if (token_vector[i] == "DIRECTIVE_DB" ||
-                    token_vector[i] == "DIRECTIVE_DW" ||
-                    token_vector[i] == "DIRECTIVE_DD")
-                    break;
-                expr += lexeme_vector[i];
-            }
-            //                                                            dw and dd should be supported too
-            if (i < token_vector.size() && token_vector[i] == "DIRECTIVE_DB" && i + 1 < lexeme_vector.size())
-                dataValue = stringToInt(lexeme_vector[i + 1]);
+    const uint32_t value = static_cast<uint32_t>(operand.value);
+    for (int k = 0; k < byteSize; k++)
+        *dest++ = static_cast<char>((value >> (8 * k)) & 0xFF);
+    return dest;
+}
 
-            auto replacedExpr = expr;
-            size_t pos;
+/**
+ * @brief Records bytes of data at the current location counter.
+ *
+ * @param bytes The bytes, kept in the arena.
+ * @param count Number of times the bytes are repeated.
+ * @param padding True for a TIMES whose count depends on $.
+ */
+static void record_data(AsmContext &ctx, std::string_view bytes, uint32_t count, bool padding)
+{
+    ctx.ir_data.push_back(IrData{ctx.location_counter, static_cast<uint32_t>(ctx.ir.size()),
+                                 static_cast<uint32_t>(ctx.ir_barriers.size()), count, bytes, padding});
+}
 
-            while ((pos = replacedExpr.find("$$")) != std::string::npos)
-                replacedExpr.replace(pos, 2, std::to_string(*blcPointer));
+/**
+ * @brief Records the bytes of one repeated data operand (TIMES n DB x).
+ *
+ * @param operand A number or a string.
+ * @param byteSize 1 for DB, 2 for DW, 4 for DD.
+ * @param count Number of times the operand is repeated.
+ * @param padding True for a TIMES whose count depends on $.
+ */
+static void define_data(AsmContext &ctx, const Token &operand, int byteSize, uint32_t count, bool padding)
+{
+    const size_t size = data_size(operand, byteSize);
+    if (size == 0 || (count == 0 && !padding))
+        return;
 
-            while ((pos = replacedExpr.find("$")) != std::string::npos)
-                replacedExpr.replace(pos, 1, std::to_string(*lcPointer));
+    char *bytes = static_cast<char *>(ctx.arena.allocate(size, 1));
+    put_data(bytes, operand, byteSize);
+    record_data(ctx, std::string_view(bytes, size), count, padding);
+}
 
-            try
-            {
-                repeatCount = evalWithParentheses(replacedExpr); // for (3 + 2) * 5 like statements
-            }
-            catch (const std::exception &ex)
-            {
-                std::cerr << "Error evaluating expression: " << ex.what() << std::endl;
-                repeatCount = 0; // some sensible default/error value
-            }
+/**
+ * @brief Defines the data of a DB, DW or DD operand list and moves the
+ * location counter past it.
+ *
+ * The operands are numbers, negated numbers and strings separated by
+ * commas, e.g. db 'abc', 0, -1. Anything else is an error, so no operand
+ * is silently dropped.
+ *
+ * @param line Tokens of the line, ending with TOKEN_EOL.
+ * @param first Index of the first operand.
+ * @param byteSize 1 for DB, 2 for DW, 4 for DD.
+ */
+static void define_data_list(AsmContext &ctx, const LineView &line, size_t first, int byteSize)
+{
+    // A TOKEN_ERROR was already reported by the lexer and ends the operands
+    const auto ends = [&line](size_t i) { return line[i].type == TOKEN_EOL || line[i].type == TOKEN_ERROR; };
+    if (line[first].type == TOKEN_EOL)
+        throw AssemblyError("Data directive missing value");
+
+    // First pass checks the operands and sizes the data
+    size_t size = 0;
+    for (size_t i = first; !ends(i); i++)
+    {
+        if (line[i].type == TOKEN_MINUS && line[i + 1].type == TOKEN_NUMBER)
+            i++;
+        else if (line[i].type != TOKEN_NUMBER && line[i].type != TOKEN_STRING)
+            throw AssemblyError("Unsupported operand in data directive: " + std::string(token_text(line[i])));
+        size += data_size(line[i], byteSize);
 
-            if (token_vector.size() > i + 1)
-            {
-                std::string defineSize = token_vector[i].substr(9);
-                std::string operandToken = token_vector[i + 1];
-                std::string operandLexeme = lexeme_vector[i + 1];
-                handle_times(repeatCount, defineSize, operandToken, operandLexeme);
-            }
-        }
+        if (ends(i + 1))
+            break;
+        if (line[i + 1].type != TOKEN_COMMA)
+            throw AssemblyError("Expected a comma between data directive operands");
+        if (line[i + 2].type == TOKEN_EOL)
+            throw AssemblyError("Expected a value after comma in data directive");
+        i++;
     }
-    else if (token_vector[0].find("INSTR_") == 0)
+    if (size == 0)
+        return;
+
+    char *bytes = static_cast<char *>(ctx.arena.allocate(size, 1));
+    char *dest = bytes;
+    for (size_t i = first; !ends(i); i++)
     {
-        if (token_vector[0] == "INSTR_GENERIC")
+        if (line[i].type == TOKEN_COMMA)
+            continue;
+        if (line[i].type == TOKEN_MINUS)
         {
-            if (likely(token_vector.size() > 1 && token_vector[1].find("DIRECTIVE_") == 0))
-            {
-                if (token_vector[1] == "DIRECTIVE_EQU")
-                {
-                    // Handle EQU directive: symbol = value (e.g. symbol EQU value)
-                    if (lexeme_vector.size() > 2)
-                        symbol_table[lexeme_vector[0]] = lexeme_vector[2];
-                    else
-                        fatal_error("EQU directive missing value");
-                }
-                else
-                {
-                    const std::string &directive = token_vector[1];
-                    int byteSize = incByte(directive.substr(10)); // Remove "DIRECTIVE_" prefix
-
-                    // msg db "Hello, EASM!", 0
-                    if (token_vector.size() > 4 && token_vector[2] == "STRING" && token_vector[3] == "COMMA" && token_vector[4] == "NUMBER")
-                    {
-                        // Example: symbol DB "abc", 3
-                        std::string hexString = stringAndNumberToHex(lexeme_vector[2], lexeme_vector[4]);
-                        symbol_table[lexeme_vector[0]] = hexString;
-                        int bytes = countBytesInHexString(hexString);
-                        *lcPointer += bytes * byteSize;
-                    } // msg db "Hello, EASM!""
-                    else if (token_vector.size() > 2 && token_vector[2] == "STRING" && token_vector[3] == "EOL")
-                    {
-                        // Example: symbol DB "abc"
-                        std::string hexString = stringToHexInString(lexeme_vector[2]);
-                        symbol_table[lexeme_vector[0]] = hexString;
-                        int bytes = countBytesInHexString(hexString);
-                        *lcPointer += bytes * byteSize;
-                    } // msg db 0
-                    else if (token_vector.size() > 2 && token_vector[2] == "NUMBER")
-                    {
-                        // Example: symbol DB 123
-                        symbol_table[lexeme_vector[0]] = lexeme_vector[2];
-                        *lcPointer += byteSize;
-                    }
-                    else
-                    {
-                        fatal_error("Unsupported operand format in directive");
-                    }
-                }
-            }
-            else
-            {
-                fatal_error("Expected a directive token");
-            }
+            Token negated = line[++i];
+            negated.value = -negated.value;
+            dest = put_data(dest, negated, byteSize);
         }
         else
         {
-            handleInstructions(token_vector, lexeme_vector);
+            dest = put_data(dest, line[i], byteSize);
         }
     }
-    else if (token_vector[0] == "EOL") // empty line in .asm code
-    {
-        return;
-    }
-    else if (token_vector[0] == "DOT")
+    record_data(ctx, std::string_view(bytes, size), 1, false);
+    ctx.location_counter += static_cast<int>(size);
+}
+
+/**
+ * @brief Handles a line that starts with a directive (BITS, ORG, DB, TIMES, ...).
+ *
+ * @param ctx The assembly the line belongs to.
+ * @param line Tokens of the line, ending with TOKEN_EOL.
+ */
+static void handle_directive(AsmContext &ctx, const LineView &line)
+{
+    const InstructionType directive = line[0].instr_type;
+
+    switch (directive)
     {
-        if (token_vector[1] == "LABEL") // local labels like .loop:
+    case DIRECTIVE_BITS:
+        ctx.current_bits_mode = (int)line[1].value; // BITS 16
+        break;
+
+    case DIRECTIVE_ORG:
+        ctx.location_counter = (int)line[1].value;
+        ctx.base_location_counter = ctx.location_counter;
+        // Code growing before an ORG does not move what follows it
+        ctx.ir_barriers.push_back(IrBarrier{static_cast<uint32_t>(ctx.ir.size()), ctx.location_counter,
+                                            ctx.location_counter, ctx.location_counter, 0, {}});
+        break;
+
+    case DIRECTIVE_DB: // handle if define x directives come first
+    case DIRECTIVE_DW:
+    case DIRECTIVE_DD:
+        // db 'Hello', 0 or dw 0xAA55, -1: each string character and number takes byteSize bytes
+        define_data_list(ctx, line, 1, incByte(directive));
+        break;
+
+    case DIRECTIVE_EQU:
+        throw AssemblyError("DIRECTIVE EQU CANNOT BE USED WITHOUT VARIABLE NAME"); // "MAXLEN equ 64" is OK.  "equ 64" is wrong
+
+    case DIRECTIVE_ALIGN:
+        align_address((uint32_t)ctx.location_counter, (uint32_t)line[1].value);
+        break;
+
+    case DIRECTIVE_TIMES:
+        //                                                        full expression
+        //                                             code start@----------------|
+        // times 510 - ($ - $$) db 0 // bootloader example
+        try
         {
-            std::string strLabel = "." + lexeme_vector[1];
-            label_table[strLabel] = location_counter;
+            handleTimesDirective(ctx, line);
         }
-        else if (token_vector[1].find("DIRECTIVE_") == 0) // EASM does not support DOT DIRECTIVES (.equ)
+        catch (const AssemblyError &)
         {
-            fatal_error("EASM DOES NOT SUPPORT .DIRECTIVE STRUCTURE");
+            throw;
         }
-    }
-    else if (token_vector[0] == "LABEL")
-    {
-        std::string label = lexeme_vector[0];
-        if (!label.empty() && label.back() == ':')
+        catch (const std::exception &ex)
         {
-            label.pop_back();
+            ctx.diagnostics << "Error evaluating expression: " << ex.what() << "\n";
         }
-        label_table[label] = location_counter;
-    }
-    else
-    {
-        fatal_error("UNKNOWN ERROR HAPPENED");
+        break;
+
+    default:
+        break;
     }
 }
 
-std::string stringAndNumberToHex(const std::string &text, const std::string &numberStr)
+/**
+ * @brief Handles a line that starts with a plain identifier: "name EQU value" or "name DB ...".
+ *
+ * @param ctx The assembly the line belongs to.
+ * @param line Tokens of the line, ending with TOKEN_EOL.
+ */
+static void handle_named_directive(AsmContext &ctx, const LineView &line)
 {
-    std::ostringstream oss;
-
-    // Convert text to hex
-    for (auto c : text)
-    {
-        oss << std::uppercase << std::hex << std::setw(2) << std::setfill('0')
-            << static_cast<int>(c) << " ";
-    }
+    if (unlikely(line.size() < 2 || line[1].type != TOKEN_INSTR || line[1].instr_type < DIRECTIVE_ORG))
+        throw AssemblyError("Expected a directive token");
 
-    // Convert numberStr to integer (supports decimal or hex string)
-    int number = 0;
-    if (numberStr.size() > 2 && (numberStr[0] == '0') && (numberStr[1] == 'x' || numberStr[1] == 'X'))
+    if (line[1].instr_type == DIRECTIVE_EQU)
     {
-        number = std::stoi(numberStr, nullptr, 16); // hex string like "0x1F"
-    }
-    else
-    {
-        number = std::stoi(numberStr, nullptr, 10); // decimal string like "32"
+        // MAXLEN equ 64
+        define_symbol(ctx, line[0].symbol, equ_value(line));
+        return;
     }
 
-    // Append number in hex form
-    oss << std::uppercase << std::hex << std::setw(2) << std::setfill('0')
-        << (number & 0xFF);
-
-    return oss.str();
-}
-
-std::string stringToHexInString(const std::string &text)
-{
-    std::ostringstream oss;
-    for (char c : text)
-    {
-        unsigned char uc = static_cast<unsigned char>(c);
-        oss << std::uppercase << std::hex
-            << std::setw(2) << std::setfill('0')
-            << static_cast<int>(uc) << " ";
-    }
-    std::string result = oss.str();
-    if (!result.empty() && result.back() == ' ')
-        result.pop_back();
-    return result;
-}
+    // The name is also a label for the address of its data (mov si, msg)
+    define_label(ctx, line[0].symbol);
 
-std::vector<uint8_t> hexStringToBytes(const std::string &hexStr)
-{
-    std::vector<uint8_t> bytes;
-    std::istringstream iss(hexStr);
-    std::string byteStr;
-
-    while (iss >> byteStr)
-    { // get space-separated hex bytes
-        uint8_t byteVal = static_cast<uint8_t>(std::stoi(byteStr, nullptr, 16));
-        bytes.push_back(byteVal);
-    }
-    return bytes;
+    // msg db "Hello, EASM!", 0
+    define_data_list(ctx, line, 2, incByte(line[1].instr_type));
 }
-// std::string hexText = stringAndNumberToHex("Hello", 0); // "48 65 6C 6C 6F 00"
-// std::vector<uint8_t> realBytes = hexStringToBytes(hexText);
 
 /**
- * @brief Checks whether a token represents a label.
+ * @brief Main parsing handler for processing tokenized assembly input.
  *
- * A label token is identified by having a trailing colon ':' character
- * or by token type "LABEL".
+ * This function supports label detection and storage, directive handling,
+ * and instruction parsing including operand type resolution and opcode lookup.
+ * Dispatch is done on the TokenType and InstructionType of the tokens.
+ * Errors that stop the assembly are thrown as AssemblyError.
  *
- * @param token The token string to check.
- * @param lexeme The original lexeme string to check for trailing colon.
- * @return true if the token is a label; otherwise, false.
+ * @param ctx The assembly the line belongs to.
+ * @param line Tokens of one source line, ending with TOKEN_EOL.
  */
-bool is_label_token(const std::string &token, const std::string &lexeme)
+void handle_parse(AsmContext &ctx, const LineView &line)
 {
-    if (token == "LABEL")
-        return true;
-    if (!lexeme.empty() && lexeme.back() == ':')
-        return true;
-    return false;
-}
+    switch (line[0].type)
+    {
+    case TOKEN_INSTR:
+        if (line[0].instr_type >= DIRECTIVE_ORG) // handle directives first
+        {
+            handle_directive(ctx, line);
+        }
+        else if (line[0].instr_type == INSTR_GENERIC)
+        {
+            handle_named_directive(ctx, line);
+        }
+        else
+        {
+            handleInstructions(ctx, line);
+        }
+        break;
 
-/**
- * @brief Removes the trailing colon from a label token, handling both normal and local (.label) formats.
- *
- * For normal labels: LABEL:
- * For local labels: DOT LABEL COLON
- *
- * @param tokens   The token list.
- * @param lexemes  The lexeme list (same indexing as tokens).
- * @param idx      The current index in the token list pointing to the label start.
- * @return The combined label string without the trailing colon.
- */
-std::string strip_label(const std::vector<std::string> &tokens,
-                        const std::vector<std::string> &lexemes,
-                        size_t idx)
-{
+    case TOKEN_EOL: // empty line in .asm code
+        break;
 
-    // Handle local labels like ".loop:"
-    if (tokens[idx] == "DOT" && idx + 1 < tokens.size() && tokens[idx + 1] == "LABEL")
-    {
-        std::string combined = "." + lexemes[idx + 1];
-        return combined; // No colon in lexeme since colon is separate token
-    }
+    case TOKEN_DOT:
+        if (line[1].type == TOKEN_LABEL) // local labels like .loop:
+        {
+            define_local_label(ctx, line[1].symbol);
+        }
+        else if (line[1].type == TOKEN_INSTR && line[1].instr_type >= DIRECTIVE_ORG) // EASM does not support DOT DIRECTIVES (.equ)
+        {
+            throw AssemblyError("EASM DOES NOT SUPPORT .DIRECTIVE STRUCTURE");
+        }
+        break;
 
-    // Handle normal labels like "start:"
-    if (tokens[idx] == "LABEL")
-    {
-        std::string label = lexemes[idx];
-        if (!label.empty() && label.back() == ':')
-            return label.substr(0, label.size() - 1);
-        return label;
-    }
+    case TOKEN_LABEL:
+        define_label(ctx, line[0].symbol);
+        break;
 
-    return lexemes[idx];
+    default:
+        throw AssemblyError("UNKNOWN ERROR HAPPENED");
+    }
 }
 
 /**
- * @brief Determines the operand type from a token string.
+ * @brief Determines the operand type from a token.
  *
- * This function maps detailed register tokens (e.g., REG16_AX) and
- * immediate or memory tokens to a generalized OperandType.
+ * This function maps register tokens (e.g., REG16_AX) and
+ * immediate or string tokens to a generalized OperandType.
+ * Numbers are sized from the value the lexer already parsed.
  *
- * @param token The token string representing the operand.
+ * @param token The token representing the operand.
  * @return The corresponding OperandType. Returns OperandType::NONE if unrecognized.
  */
-OperandType get_operand_type_from_token(const std::string &token, const std::string &lexeme)
+OperandType get_operand_type_from_token(const Token &token)
 {
-    if (token.find("REG8_") == 0)
-        return OperandType::REG8;
-    if (token == "REG8")
+    switch (token.type)
+    {
+    case TOKEN_REG8:
         return OperandType::REG8;
-
-    if (token.find("REG16_") == 0)
-        return OperandType::REG16;
-    if (token == "REG16")
+    case TOKEN_REG16:
         return OperandType::REG16;
-
-    // if (token.find("REG32_") == 0) return OperandType::REG32;
-    // if (token == "REG32") return OperandType::REG32;
-
-    if (token.find("SEGREG_") == 0)
-        return OperandType::SEGREG;
-    if (token == "SEGREG")
+    // case TOKEN_REG32:
+    //     return OperandType::REG32;
+    case TOKEN_SEGREG:
         return OperandType::SEGREG;
-
-    // if (token == "IMM8") return OperandType::IMM8;
-    // if (token == "IMM16") return OperandType::IMM16;
-    // if (token == "IMM32") return OperandType::IMM32;
-
-    if (token == "MEM8")
-        return OperandType::MEM8;
-    if (token == "MEM16")
-        return OperandType::MEM16;
-    // if (token == "MEM32") return OperandType::MEM32;
-
-    if (token == "STRING")
-    {
+    case TOKEN_STRING:
         return OperandType::STRING;
-    }
-
-    if (token == "NUMBER")
-    {
-        // Parse the lexeme into an integer
-        long value = std::stol(lexeme, nullptr, 0); // auto-detects base (0x.., decimal, etc.)
-
-        // Check range for signed or unsigned 8-bit
-        if (value >= -128 && value <= 255)
-        {
+    case TOKEN_CHAR:
+        return OperandType::CHAR;
+    case TOKEN_NUMBER:
+        if (token.value < IMM16_MIN || token.value > IMM16_MAX)
+            throw AssemblyError("Immediate out of 16-bit range: " + std::string(token_text(token)));
+        // The imm8 forms (83 /0) sign-extend their byte, so 128..255 needs imm16
+        if (token.value >= -128 && token.value <= 127)
             return OperandType::IMM8;
-        }
-        else
-        {
-            return OperandType::IMM16;
-        }
+        return OperandType::IMM16;
+    default:
+        return OperandType::NONE;
     }
-    return OperandType::NONE;
-}
-
-int stringToHexNumber(const std::string &input)
-{
-    return std::stoi(input, nullptr, 0);
 }
 
 //  expression evaluator
-int evaluateExpr(const std::string &expr, int currentAddr, int baseAddr)
+int evaluateExpr(std::string_view expr, int currentAddr, int baseAddr)
 {
     // Replace $ and $$ with currentAddr and baseAddr respectively
     std::string replaced;
@@ -509,7 +470,7 @@ int evaluateExpr(const std::string &expr, int currentAddr, int baseAddr)
 
     std::function<int()> parseExpr, parseXor, parseAnd, parseShift, parseTerm, parseFactor;
 
-    // parse number: optional sign, decimal or hex (0x)
+    // parse number: optional sign, then a literal in any syntax the lexer accepts (0x1F, 1Fh, 101b, ...)
     auto parseNumber = [&]() -> int
     {
         skipSpaces();
@@ -525,27 +486,13 @@ int evaluateExpr(const std::string &expr, int currentAddr, int baseAddr)
             throw std::runtime_error("Expected number at pos " + std::to_string(pos));
 
         size_t start = pos;
-        if (replaced[pos] == '0' && pos + 1 < replaced.size() &&
-            (replaced[pos + 1] == 'x' || replaced[pos + 1] == 'X'))
-        {
-            pos += 2;
-            size_t hexStart = pos;
-            while (pos < replaced.size() && isxdigit((unsigned char)replaced[pos]))
-                ++pos;
-            if (hexStart == pos)
-                throw std::runtime_error("Invalid hex literal");
-            std::string hexStr = replaced.substr(start, pos - start);
-            int val = std::stoi(hexStr, nullptr, 0);
-            return neg ? -val : val;
-        }
-        else
-        {
-            while (pos < replaced.size() && isdigit((unsigned char)replaced[pos]))
-                ++pos;
-            std::string numStr = replaced.substr(start, pos - start);
-            int val = std::stoi(numStr, nullptr, 0);
-            return neg ? -val : val;
-        }
+        while (pos < replaced.size() && (isalnum((unsigned char)replaced[pos]) || replaced[pos] == '_'))
+            ++pos;
+        long value = 0;
+        if (lexer_parse_number(replaced.data() + start, static_cast<int>(pos - start), &value) != 0)
+            throw std::runtime_error("Invalid numeric literal '" + replaced.substr(start, pos - start) + "'");
+        const int val = static_cast<int>(value);
+        return neg ? -val : val;
     };
 
     // Factor: handle unary +, -, ~ and parentheses
@@ -704,28 +651,18 @@ int evaluateExpr(const std::string &expr, int currentAddr, int baseAddr)
     return result;
 }
 
-void handleTimesDirective(const std::vector<std::string> &token_vector,
-                          const std::vector<std::string> &lexeme_vector,
-                          int *p_lcPointer, int *p_blcPointer) // they start with p_ (parameter) so the compiler would not show warning about these.
+void handleTimesDirective(AsmContext &ctx, const LineView &line)
 {
-    // 1) Find the index of the size-directive token (db/dw/dd) in lexeme_vector (case-insensitive)
-    ssize_t sizeIdx = -1;
-    for (size_t i = 1; i < lexeme_vector.size(); ++i)
-    {
-        std::string up = toUpperStr(lexeme_vector[i]);
-        if (up == "DIRECTIVE_DB" || up == "DIRECTIVE_DW" || up == "DIRECTIVE_DD")
-        {
-            sizeIdx = (ssize_t)i;
-            break;
-        }
-    }
+    // 1) Find the index of the size-directive token (db/dw/dd)
+    size_t sizeIdx = 1;
+    while (sizeIdx < line.size() && !is_define_directive(line[sizeIdx]))
+        ++sizeIdx;
 
-    // 2) Build expr from lexemes between index 1 and sizeIdx (exclusive). If sizeIdx==-1, take rest.
+    // 2) Build expr from lexemes between index 1 and sizeIdx (exclusive).
     std::string expr;
-    size_t exprEnd = (sizeIdx == -1) ? lexeme_vector.size() : (size_t)sizeIdx;
-    for (size_t i = 1; i < exprEnd; ++i)
+    for (size_t i = 1; i < sizeIdx && line[i].type != TOKEN_EOL; ++i)
     {
-        expr += lexeme_vector[i];
+        expr += token_text(line[i]);
     }
     if (expr.empty())
     {
@@ -736,7 +673,7 @@ void handleTimesDirective(const std::vector<std::string> &token_vector,
     int repeatCount = 0;
     try
     {
-        repeatCount = evaluateExpr(expr, *p_lcPointer, *p_blcPointer);
+        repeatCount = evaluateExpr(expr, ctx.location_counter, ctx.base_location_counter);
     }
     catch (const std::exception &ex)
     {
@@ -745,359 +682,428 @@ void handleTimesDirective(const std::vector<std::string> &token_vector,
         throw std::runtime_error(oss.str());
     }
 
-    // 4) If we found size/operand, prepare defineSize and operandToken/lexeme
-    if (sizeIdx != -1)
+    // 4) If we found size/operand, hand them to handle_times
+    if (sizeIdx + 1 < line.size())
     {
-        std::string defineSize = toUpperStr(lexeme_vector[sizeIdx]); // DB/DW/DD
-        std::string operandToken;
-        std::string operandLexeme;
-        if (sizeIdx + 1 < lexeme_vector.size())
+        const int start = ctx.location_counter;
+        const Token &operand = line[sizeIdx + 1];
+
+        // A count that depends on $ pads up to an address, so it has to be
+        // evaluated again if branch relaxation moves the code before it
+        const bool padding = expr.find('$') != std::string::npos;
+        if (operand.type != TOKEN_EOL && line[sizeIdx + 2].type != TOKEN_EOL)
+            throw AssemblyError("TIMES repeats a single data operand");
+        handle_times(ctx, repeatCount, line[sizeIdx].instr_type, operand, padding);
+
+        if (padding)
         {
-            // try to find corresponding token at same index (best-effort)
-            if (sizeIdx + 1 < token_vector.size())
-            {
-                operandToken = token_vector[sizeIdx + 1];
-            }
-            operandLexeme = lexeme_vector[sizeIdx + 1];
+            const int unit = static_cast<int>(data_size(operand, incByte(line[sizeIdx].instr_type)));
+            ctx.ir_barriers.push_back(IrBarrier{static_cast<uint32_t>(ctx.ir.size()), start, ctx.location_counter,
+                                                ctx.base_location_counter, unit, ctx.arena.keep(expr)});
         }
-        // call existing handle_times
-        handle_times(repeatCount, defineSize, operandToken, operandLexeme);
     }
     else
     {
-        // no size/operand, just call with empty operand -> delegate behavior to handle_times
-        handle_times(repeatCount, "", "", "");
+        throw AssemblyError("Unsupported size in times directive");
     }
 }
 
-void handle_times(int count, const std::string &defineSize, const std::string &operandToken, const std::string &operandLexeme)
+void handle_times(AsmContext &ctx, int count, InstructionType defineSize, const Token &operand, bool padding)
 {
     int byteSize = incByte(defineSize);
     if (byteSize == 0)
     {
-        fatal_error("Unsupported size in times directive");
+        throw AssemblyError("Unsupported size in times directive");
+    }
+    if (count < 0)
+    {
+        throw AssemblyError("Negative count in times directive");
     }
 
-    for (int i = 0; i < count; ++i)
+    switch (operand.type)
     {
-        if (operandToken == "NUMBER")
-        {
-            *lcPointer += byteSize;
-        }
-        else if (operandToken == "STRING")
-        {
-            std::string hexString = stringToHexInString(operandLexeme);
-            int bytesCount = countBytesInHexString(hexString);
-            *lcPointer += bytesCount * byteSize;
-        }
-        else
-        {
-            fatal_error("Unsupported operand in times directive");
-        }
+    case TOKEN_NUMBER:
+    case TOKEN_STRING:
+        define_data(ctx, operand, byteSize, static_cast<uint32_t>(count), padding);
+        ctx.location_counter += count * static_cast<int>(data_size(operand, byteSize));
+        break;
+    default:
+        throw AssemblyError("Unsupported operand in times directive");
     }
 }
 
-void handleInstructions(std::vector<std::string> token_vector,
-                        std::vector<std::string> lexeme_vector)
+/**
+ * @brief Returns how many displacement bytes a memory operand adds after the ModR/M byte.
+ */
+static int disp_size(const IrOperand &m)
+{
+    if (!is_memory(m.type))
+        return 0;
+    const uint8_t mod = static_cast<uint8_t>(m.reg >> 6);
+    if (mod == 0b01)
+        return 1;
+    if (mod == 0b10 || (mod == 0b00 && (m.reg & 7) == 0b110))
+        return 2;
+    return 0;
+}
+
+/**
+ * @brief Packs a parsed operand into its IR form.
+ */
+static IrOperand to_ir_operand(const ParsedOperand &op)
+{
+    IrOperand ir{op.type, 0, 0, 0};
+    switch (op.type)
+    {
+    case OperandType::REG8:
+        ir.reg = reg8_codes[op.reg8];
+        break;
+    case OperandType::REG16:
+        ir.reg = reg16_codes[op.reg16];
+        break;
+    case OperandType::SEGREG:
+        ir.reg = seg_codes[op.segreg];
+        break;
+    case OperandType::MEM8:
+    case OperandType::MEM16:
+        ir.reg = static_cast<uint8_t>((op.modrm_mod << 6) | op.modrm_rm);
+        ir.disp = op.displacement;
+        break;
+    case OperandType::IMM8:
+    case OperandType::IMM16:
+        ir.imm = static_cast<int32_t>(op.imm);
+        break;
+    default:
+        break;
+    }
+    return ir;
+}
+
+/**
+ * @brief Pass 1 for an instruction line: parses the operands, picks the
+ * opcode form, sizes the instruction and appends it to the IR.
+ *
+ * The location counter advances by the size, so labels defined later
+ * get their final address. Symbolic immediates are recorded as
+ * expressions and resolved in pass 2.
+ *
+ * @param ctx The assembly the line belongs to.
+ * @param line Tokens of the line, ending with TOKEN_EOL.
+ */
+void handleInstructions(AsmContext &ctx, const LineView &line)
 {
-    init_opcode_table();
-    const std::string mnemonic = toUpperStr(lexeme_vector[0]);
+    const InstructionType mnemonic = line[0].instr_type;
 
     size_t idx = 1;
-    ParsedOperand op1{OperandType::NONE, "", 0, 0, 0, 0};
-    ParsedOperand op2{OperandType::NONE, "", 0, 0, 0, 0};
+    ParsedOperand op1{OperandType::NONE, {}, 0, REG8_NONE, REG16_NONE, SEGREG_NONE, 0, 0, 0, 0, false, 0, false};
+    ParsedOperand op2{OperandType::NONE, {}, 0, REG8_NONE, REG16_NONE, SEGREG_NONE, 0, 0, 0, 0, false, 0, false};
 
     // Parse operands (if any)
-    if (idx < token_vector.size() && token_vector[idx] != "EOL")
+    if (idx < line.size() && line[idx].type != TOKEN_EOL)
     {
-        op1 = parseOperand(token_vector, lexeme_vector, idx);
+        op1 = parseOperand(line, idx);
     }
-    if (idx < token_vector.size() && token_vector[idx] == "COMMA")
+    if (idx < line.size() && line[idx].type == TOKEN_COMMA)
     {
         idx++; // skip comma
-        if (idx < token_vector.size() && token_vector[idx] != "EOL")
+        if (idx < line.size() && line[idx].type != TOKEN_EOL)
         {
-            op2 = parseOperand(token_vector, lexeme_vector, idx);
+            op2 = parseOperand(line, idx);
         }
         else
         {
-            fatal_error("Expected second operand after comma");
+            throw AssemblyError("Expected second operand after comma");
         }
     }
 
-    bool skip_opcode_lookup = false;
-        if (op1.type == OperandType::CHAR || op1.type == OperandType::STRING ||
-            op2.type == OperandType::CHAR || op2.type == OperandType::STRING)
-        {
-            skip_opcode_lookup = true;
-        }
+    // Character and string operands have no instruction encoding
+    if (op1.type == OperandType::CHAR || op1.type == OperandType::STRING ||
+        op2.type == OperandType::CHAR || op2.type == OperandType::STRING)
+    {
+        return;
+    }
 
-    OpcodeInfo* info = nullptr;
+    // Lookup opcode by (mnemonic, op1.type, op2.type)
+    uint8_t form = opcode_table.find_form(mnemonic, op1.type, op2.type);
+    if (!form && (op1.type == OperandType::IMM8 || op2.type == OperandType::IMM8))
+    {
+        // A small number also fits the imm16 of a form without an imm8 variant (mov ax, 5)
+        if (op1.type == OperandType::IMM8)
+            op1.type = OperandType::IMM16;
+        if (op2.type == OperandType::IMM8)
+            op2.type = OperandType::IMM16;
+        form = opcode_table.find_form(mnemonic, op1.type, op2.type);
+    }
+    if (!form)
+        throw AssemblyError("Opcode not found for given operands");
+    const OpcodeInfo &info = opcode_table.form(form);
+
+    IrInstr instr{};
+    instr.address = static_cast<uint32_t>(ctx.location_counter);
+    instr.line = static_cast<uint32_t>(line[0].line);
+    instr.mnemonic = static_cast<uint8_t>(mnemonic);
+    instr.prefix = static_cast<uint8_t>(op1.seg_prefix | op2.seg_prefix);
+    instr.form = form;
+    instr.op[0] = to_ir_operand(op1);
+    instr.op[1] = to_ir_operand(op2);
+
+    int size = instr.prefix ? 2 : 1; // segment override + primary opcode
+    if (info.requires_modrm)
+    {
+        size += 1 + disp_size(instr.op[0]) + disp_size(instr.op[1]);
+    }
 
-    if (!skip_opcode_lookup)
+    // A label added to the address of a memory operand
+    const ParsedOperand *memOp = is_memory(op1.type) ? &op1 : is_memory(op2.type) ? &op2 : nullptr;
+    if (memOp && memOp->symbol)
     {
-        // Lookup opcode by (mnemonic, op1.type, op2.type)
-        OperandKey key{mnemonic, op1.type, op2.type};
-        auto it = opcode_map.find(key);
-        if (it == opcode_map.end())
-            fatal_error("Opcode not found for given operands");
-        info = &it->second;
+        ctx.ir_exprs.push_back(IrExpr{memOp->symbol_id, ctx.label_scope, memOp->local, true});
+        instr.expr = static_cast<uint32_t>(ctx.ir_exprs.size());
     }
+    if (info.has_imm)
+    {
+        // Choose which operand carries the immediate
+        const ParsedOperand *immOp = nullptr;
+        if (is_immediate(op2.type))
+            immOp = &op2;
+        else if (is_immediate(op1.type))
+            immOp = &op1;
 
-    auto u8 = [](int v) -> uint8_t
-    { return static_cast<uint8_t>(v & 0xFF); };
-    auto u16 = [](unsigned v) -> uint16_t
-    { return static_cast<uint16_t>(v & 0xFFFF); };
+        if (!immOp)
+            throw AssemblyError("Opcode expects immediate but none was parsed.");
+        if (info.imm_size != 1 && info.imm_size != 2)
+            throw AssemblyError("Unsupported immediate size in opcode table");
 
-    // Helpers
-    auto build_mod = [](const ParsedOperand &m) -> uint8_t
-    {
-        // Special case: in 8086, mod=00 & r/m=110 means [disp16] direct.
-        // If user encoded [BP] with no displacement (r/m=110), force disp8=0 (mod=01) to mean [BP + 0].
-        if (m.displacement == 0)
+        if (immOp->symbol)
         {
-            if (m.modrm_rm == 0b110)
-            {                // [BP] cannot be encoded with mod=00
-                return 0b01; // force 8-bit disp of 0
-            }
-            return 0b00;
+            if (instr.expr)
+                throw AssemblyError("Only one label per instruction is supported");
+            ctx.ir_exprs.push_back(IrExpr{immOp->symbol_id, ctx.label_scope, immOp->local, false});
+            instr.expr = static_cast<uint32_t>(ctx.ir_exprs.size());
         }
-        const int d = m.displacement;
-        return (d >= -128 && d <= 127) ? 0b01 : 0b10; // 8-bit or 16-bit disp
-    };
-    auto modrm_byte = [](uint8_t mod, uint8_t reg, uint8_t rm) -> uint8_t
-    {
-        return static_cast<uint8_t>((mod << 6) | ((reg & 7) << 3) | (rm & 7));
-    };
-    auto print_disp = [&](const ParsedOperand &m, uint8_t mod)
+        size += info.imm_size;
+    }
+
+    instr.size = static_cast<uint8_t>(size);
+    ctx.ir.push_back(instr);
+    ctx.location_counter += size;
+}
+
+long resolveSymbol(const AsmContext &ctx, const IrInstr &instr)
+{
+    const IrExpr &expr = ctx.ir_exprs[instr.expr - 1];
+
+    if (const IrLabel *label = find_label(ctx, expr))
+        return label->address;
+
+    // An EQU of another name follows it to a number or a label; a cycle
+    // ends after as many steps as there are names
+    if (!expr.local)
     {
-        if (mod == 0b01)
+        uint32_t symbol = expr.symbol;
+        for (size_t steps = 0; steps < ctx.symbol_table.size() && ctx.symbol_table[symbol].defined; steps++)
         {
-            std::cout << "Disp8:  0x" << std::hex << (int)u8(m.displacement) << "\n";
+            const IrSymbol &equ = ctx.symbol_table[symbol];
+            if (!equ.alias)
+                return equ.value;
+            symbol = equ.alias - 1;
+            if (ctx.label_table[symbol].defined)
+                return ctx.label_table[symbol].address;
         }
-        else if (mod == 0b10)
-        {
-            std::cout << "Disp16: 0x" << std::hex << u16(static_cast<unsigned>(m.displacement)) << "\n";
-        }
-        else if (mod == 0b00 && m.modrm_rm == 0b110)
-        {
-            // Direct [disp16] addressing (mod=00, r/m=110)
-            std::cout << "Disp16 (direct): 0x" << std::hex
-                      << u16(static_cast<unsigned>(m.displacement)) << "\n";
-        }
-    };
-
-    // 1) Primary opcode
-    if (!skip_opcode_lookup){
-        std::cout << "Opcode: 0x" << std::hex << (int)info->primary_opcode << "\n";
-        (*lcPointer)++;
     }
-    
 
-    // 2) ModR/M (if needed) + displacement (if any)
-    if (info && info->requires_modrm)
+    std::string name = expr.local ? "." : "";
+    name += symbol_name(ctx.tokens, expr.symbol);
+    throw AssemblyError("Undefined symbol: " + name + " (line " + std::to_string(instr.line) + ")");
+}
+
+/**
+ * @brief Pass 2 for one instruction: encodes it from the IR record.
+ *
+ * The encoder specialized for the operand types of the form was bound
+ * to it when the opcode table was built, so this is one indirect call.
+ * Only reads the context, so instructions can be encoded on several
+ * threads at once.
+ *
+ * @param ctx The assembly the instruction belongs to.
+ * @param instr The instruction, as collected by pass 1.
+ * @param dest Receives instr.size bytes.
+ * @param listing Receives one line per encoded field, or nullptr for no listing.
+ */
+void encodeInstruction(const AsmContext &ctx, const IrInstr &instr, uint8_t *dest, std::string *listing)
+{
+    ByteWriter out(dest, listing);
+    opcode_table.encoder(instr.form)(ctx, instr, opcode_table.form(instr.form), out);
+}
+
+/**
+ * @brief Smallest number of instructions worth handing to a separate thread.
+ */
+static constexpr size_t ENCODE_CHUNK_MIN = 16384;
+
+/**
+ * @brief Typical size of the listing of one instruction, to size the listing buffers.
+ */
+static constexpr size_t LISTING_BYTES_PER_INSTR = 32;
+
+/**
+ * @brief The result of encoding one chunk of the IR.
+ */
+struct EncodeChunk
+{
+    size_t first;        /**< First IR index of the chunk. */
+    size_t last;         /**< One past the last IR index. */
+    size_t data_first;   /**< First data directive written with the chunk. */
+    size_t data_last;    /**< One past the last data directive. */
+    std::string listing; /**< Listing text of the chunk. */
+    std::string error;   /**< Message of the AssemblyError that stopped the chunk, if any. */
+    bool failed = false;
+};
+
+/**
+ * @brief Copies the bytes of a data directive into the image.
+ */
+static void write_data(const IrData &data, uint8_t *image, uint32_t image_base)
+{
+    uint8_t *dest = image + (static_cast<uint32_t>(data.address) - image_base);
+    for (uint32_t i = 0; i < data.count; i++)
     {
-        uint8_t mod = 0, reg = 0, rm = 0, mrm = 0;
+        std::memcpy(dest, data.bytes.data(), data.bytes.size());
+        dest += data.bytes.size();
+    }
+}
 
-        // ---- 16-bit width ----
-        if (op1.type == OperandType::REG16 && op2.type == OperandType::REG16)
-        {
-            // r16 <- r16 OR r/m16, r16 depending on opcode; your table determines direction.
-            mod = 0b11;
-            reg = op2.reg_code; // source in Reg
-            rm = op1.reg_code;  // dest  in R/M
-            mrm = modrm_byte(mod, reg, rm);
-        }
-        else if (op1.type == OperandType::REG16 && op2.type == OperandType::MEM16)
-        {
-            // r16 <- m16
-            mod = build_mod(op2);
-            reg = op1.reg_code;
-            rm = op2.modrm_rm;
-            mrm = modrm_byte(mod, reg, rm);
-        }
-        else if (op1.type == OperandType::MEM16 && op2.type == OperandType::REG16)
-        {
-            // m16 <- r16
-            mod = build_mod(op1);
-            reg = op2.reg_code;
-            rm = op1.modrm_rm;
-            mrm = modrm_byte(mod, reg, rm);
-        }
-        else if ((op1.type == OperandType::REG16 || op1.type == OperandType::MEM16) &&
-                 op2.type == OperandType::IMM16)
-        {
-            // r/m16 <- imm16 ; Group opcode uses opcode_ext in Reg field
-            const uint8_t ext = info->opcode_ext; // set in table (e.g., ADD = 0)
-            if (op1.type == OperandType::REG16)
-            {
-                mod = 0b11;
-                reg = ext;
-                rm = op1.reg_code;
-            }
-            else
-            {
-                mod = build_mod(op1);
-                reg = ext;
-                rm = op1.modrm_rm;
-            }
-            mrm = modrm_byte(mod, reg, rm);
-        }
-        // Some instructions use imm8 to r/m16 (sign-extended), table must have imm_size=1
-        else if ((op1.type == OperandType::REG16 || op1.type == OperandType::MEM16) &&
-                 op2.type == OperandType::IMM8)
+/**
+ * @brief Encodes the IR instructions [chunk.first, chunk.last) and the data
+ * directives between them into the image, in source order.
+ *
+ * An error stops the chunk at the failing instruction, exactly where the
+ * serial pass would have stopped.
+ */
+static void encode_chunk(const AsmContext &ctx, uint8_t *image, uint32_t image_base, EncodeChunk &chunk)
+{
+    std::string *listing = nullptr;
+    if (ctx.listing)
+    {
+        listing = &chunk.listing;
+        listing->reserve((chunk.last - chunk.first) * LISTING_BYTES_PER_INSTR);
+    }
+    const std::unique_ptr<EncodeCache> cache = std::make_unique<EncodeCache>();
+    size_t d = chunk.data_first;
+    try
+    {
+        for (size_t i = chunk.first; i < chunk.last; i++)
         {
-            const uint8_t ext = info->opcode_ext;
-            if (op1.type == OperandType::REG16)
+            for (; d < chunk.data_last && ctx.ir_data[d].anchor <= i; d++)
+                write_data(ctx.ir_data[d], image, image_base);
+            const IrInstr &instr = ctx.ir[i];
+            uint8_t *dest = image + (instr.address - image_base);
+            if (instr.expr || !cache->enabled())
             {
-                mod = 0b11;
-                reg = ext;
-                rm = op1.reg_code;
+                encodeInstruction(ctx, instr, dest, listing);
+                continue;
             }
-            else
-            {
-                mod = build_mod(op1);
-                reg = ext;
-                rm = op1.modrm_rm;
-            }
-            mrm = modrm_byte(mod, reg, rm);
-        }
 
-        // ---- 8-bit width ----
-        else if (op1.type == OperandType::REG8 && op2.type == OperandType::REG8)
-        {
-            mod = 0b11;
-            reg = op2.reg_code;
-            rm = op1.reg_code;
-            mrm = modrm_byte(mod, reg, rm);
-        }
-        else if (op1.type == OperandType::REG8 && op2.type == OperandType::MEM8)
-        {
-            mod = build_mod(op2);
-            reg = op1.reg_code;
-            rm = op2.modrm_rm;
-            mrm = modrm_byte(mod, reg, rm);
-        }
-        else if (op1.type == OperandType::MEM8 && op2.type == OperandType::REG8)
-        {
-            mod = build_mod(op1);
-            reg = op2.reg_code;
-            rm = op1.modrm_rm;
-            mrm = modrm_byte(mod, reg, rm);
-        }
-        else if ((op1.type == OperandType::REG8 || op1.type == OperandType::MEM8) &&
-                 op2.type == OperandType::IMM8)
-        {
-            // r/m8 <- imm8 ; Group opcode uses opcode_ext in Reg field
-            const uint8_t ext = info->opcode_ext; // e.g., ADD = 0
-            if (op1.type == OperandType::REG8)
-            {
-                mod = 0b11;
-                reg = ext;
-                rm = op1.reg_code;
-            }
-            else
-            {
-                mod = build_mod(op1);
-                reg = ext;
-                rm = op1.modrm_rm;
-            }
-            mrm = modrm_byte(mod, reg, rm);
-        }
-        else if (op1.type == OperandType::MEM16 && op2.type == OperandType::MEM16)
-        {
-            fatal_error("Memory-to-memory operation not encodable (use a register).");
-        }
-        else
-        {
-            fatal_error("Unhandled ModR/M combination.");
+            // Without a label reference the encoding only depends on the IR fields
+            if (cache->find(instr, dest, listing))
+                continue;
+            const size_t listed = listing ? listing->size() : 0;
+            encodeInstruction(ctx, instr, dest, listing);
+            cache->store(instr, dest,
+                         listing ? std::string_view(*listing).substr(listed) : std::string_view());
         }
+        for (; d < chunk.data_last; d++)
+            write_data(ctx.ir_data[d], image, image_base);
+    }
+    catch (const std::exception &ex)
+    {
+        chunk.error = ex.what();
+        chunk.failed = true;
+    }
+    stats_count_encode_cache(cache->lookups, cache->hits);
+}
 
-        /*
-        auto disp_size = [&](const ParsedOperand &op) -> int
-        {
-            uint8_t m = build_mod(op);
-            if (m == 0b00 && op.modrm_rm == 0b110)
-                return 2;
-            if (m == 0b01)
-                return 1;
-            if (m == 0b10)
-                return 2;
-            return 0;
-        };
-        */
-
-        std::cout << "ModR/M byte: 0x" << std::hex << (int)mrm << "\n";
-        (*lcPointer)++;
-
-        // Print displacement if present/required
-        // (We recompute mod here the same way to decide printing)
-        if ((op1.type == OperandType::MEM8 || op1.type == OperandType::MEM16))
-        {
-            uint8_t m = build_mod(op1);
-            print_disp(op1, m);
-            if (m == 0b01)
-                (*lcPointer) += 1;
-            else if (m == 0b10 || (m == 0b00 && op1.modrm_rm == 0b110))
-                (*lcPointer) += 2;
-        }
-        if ((op2.type == OperandType::MEM8 || op2.type == OperandType::MEM16))
+/**
+ * @brief Returns the index of the first data directive anchored at or after an IR index.
+ */
+static size_t first_data_at(const AsmContext &ctx, size_t index)
+{
+    return static_cast<size_t>(std::lower_bound(ctx.ir_data.begin(), ctx.ir_data.end(), index,
+                                                [](const IrData &data, size_t i) { return data.anchor < i; }) -
+                               ctx.ir_data.begin());
+}
+
+void encodeInstructions(AsmContext &ctx)
+{
+    stats_phase_begin(STATS_PHASE_ENCODE);
+
+    // Every instruction and data directive owns the bytes [address, address + size) of the image
+    uint32_t low = 0, high = 0;
+    bool ascending = true;
+    bool empty = true;
+    auto take = [&](uint32_t address, uint32_t size)
+    {
+        if (empty || address < low)
+            low = address;
+        if (!empty && address < high)
+            ascending = false; // an ORG went back; later code overwrites earlier code
+        high = std::max(high, address + size);
+        empty = false;
+    };
+    size_t d = 0;
+    for (size_t i = 0; i <= ctx.ir.size(); i++)
+    {
+        for (; d < ctx.ir_data.size() && ctx.ir_data[d].anchor <= i; d++)
         {
-            uint8_t m = build_mod(op2);
-            print_disp(op2, m);
-            if (m == 0b01)
-                (*lcPointer) += 1;
-            else if (m == 0b10 || (m == 0b00 && op2.modrm_rm == 0b110))
-                (*lcPointer) += 2;
+            const IrData &data = ctx.ir_data[d];
+            const uint32_t size = data.count * static_cast<uint32_t>(data.bytes.size());
+            if (size != 0)
+                take(static_cast<uint32_t>(data.address), size);
         }
+        if (i < ctx.ir.size())
+            take(ctx.ir[i].address, ctx.ir[i].size);
     }
+    ctx.image_base = low;
+    ctx.image.assign(high - low, 0);
 
-    // 3) Immediate (if any)
-    if (info && info->has_imm)
-    {
-        // Choose which operand carries the immediate
-        const ParsedOperand *immOp = nullptr;
-        if (op2.type == OperandType::IMM8 || op2.type == OperandType::IMM16)
-            immOp = &op2;
-        else if (op1.type == OperandType::IMM8 || op1.type == OperandType::IMM16)
-            immOp = &op1;
+    // Chunks write disjoint slices of the image only when addresses never go back
+    size_t threads = ascending ? std::min(ctx.threads, ctx.ir.size() / ENCODE_CHUNK_MIN) : 1;
+    threads = std::max<size_t>(threads, 1);
 
-        if (!immOp)
-            fatal_error("Opcode expects immediate but none was parsed.");
+    std::vector<EncodeChunk> chunks(threads);
+    for (size_t t = 0; t < threads; t++)
+    {
+        chunks[t].first = ctx.ir.size() * t / threads;
+        chunks[t].last = ctx.ir.size() * (t + 1) / threads;
+        chunks[t].data_first = first_data_at(ctx, chunks[t].first);
+        // The last chunk also takes the data after the last instruction
+        chunks[t].data_last = t + 1 < threads ? first_data_at(ctx, chunks[t].last) : ctx.ir_data.size();
+    }
 
-        if (immOp->type == OperandType::CHAR)
-        {
-            uint8_t c = static_cast<uint8_t>(immOp->value[0]);
-            std::cout << "Char byte: 0x" << std::hex << (int)c << "\n";
-            (*lcPointer) += 1;
-        }
-        else if (immOp->type == OperandType::STRING)
+    std::vector<std::thread> pool;
+    pool.reserve(threads - 1);
+    for (size_t t = 1; t < threads; t++)
+        pool.emplace_back(encode_chunk, std::cref(ctx), ctx.image.data(), ctx.image_base, std::ref(chunks[t]));
+    encode_chunk(ctx, ctx.image.data(), ctx.image_base, chunks[0]);
+    for (std::thread &thread : pool)
+        thread.join();
+
+    // Join the listings in order, up to the first failing instruction
+    size_t encoded = 0;
+    for (size_t t = 0; t < threads; t++)
+    {
+        EncodeChunk &chunk = chunks[t];
+        ctx.out.write(chunk.listing.data(), static_cast<std::streamsize>(chunk.listing.size()));
+        if (chunk.failed)
         {
-            for (char ch : immOp->value)
-            {
-                uint8_t b = static_cast<uint8_t>(ch);
-                std::cout << "String byte: 0x" << std::hex << (int)b << "\n";
-                (*lcPointer) += 1;
-            }
-        } else {
-
-            unsigned long immParsed = std::stoul(immOp->value, nullptr, 0);
-            if (info->imm_size == 1)
-            {
-                std::cout << "Immediate byte: 0x" << std::hex << (int)u8((int)immParsed) << "\n";
-                (*lcPointer) += 1;
-            }
-            else if (info->imm_size == 2)
-            {
-                std::cout << "Immediate word: 0x" << std::hex << u16(static_cast<unsigned>(immParsed)) << "\n";
-                (*lcPointer) += 2;
-            }
-            else
-            {
-                fatal_error("Unsupported immediate size in opcode table");
-            }
+            stats_phase_end(STATS_PHASE_ENCODE);
+            throw AssemblyError(chunk.error);
         }
+        encoded += chunk.last - chunk.first;
     }
+    stats_count_instructions(encoded);
+
+    stats_phase_end(STATS_PHASE_ENCODE);
 }
 
 int parseNumber(const std::string &s, size_t &pos)
@@ -19,6 +19,7 @@
 // registers.c
 #include <string.h>
 #include "include/registers.h"
+#include "include/keywords.h"
 
 /**
  * @brief Returns the name of an 8-bit register.
@@ -43,19 +44,12 @@ const char *get_register8_name(Register8 reg) {
 /**
  * @brief Returns the enum value of an 8-bit register by its name.
  *
- * @param name Null-terminated string name of the register (e.g., "AL").
+ * @param name Null-terminated string name of the register (e.g., "AL"), in any case.
  * @return Register8 Corresponding enum value, or REG8_NONE if unknown.
  */
 Register8 get_register8_by_name(const char *name) {
-    if (strcmp(name, "AL") == 0) return REG8_AL;
-    if (strcmp(name, "BL") == 0) return REG8_BL;
-    if (strcmp(name, "CL") == 0) return REG8_CL;
-    if (strcmp(name, "DL") == 0) return REG8_DL;
-    if (strcmp(name, "AH") == 0) return REG8_AH;
-    if (strcmp(name, "BH") == 0) return REG8_BH;
-    if (strcmp(name, "CH") == 0) return REG8_CH;
-    if (strcmp(name, "DH") == 0) return REG8_DH;
-    return REG8_NONE;
+    const Keyword *keyword = keyword_find(name, (int)strlen(name));
+    return keyword != NULL && keyword->type == TOKEN_REG8 ? (Register8)keyword->reg : REG8_NONE;
 }
 
 /**
@@ -81,19 +75,12 @@ const char *get_register16_name(Register16 reg) {
 /**
  * @brief Returns the enum value of a 16-bit register by its name.
  *
- * @param name Null-terminated string name of the register (e.g., "AX").
+ * @param name Null-terminated string name of the register (e.g., "AX"), in any case.
  * @return Register16 Corresponding enum value, or REG16_NONE if unknown.
  */
 Register16 get_register16_by_name(const char *name) {
-    if (strcmp(name, "AX") == 0) return REG16_AX;
-    if (strcmp(name, "BX") == 0) return REG16_BX;
-    if (strcmp(name, "CX") == 0) return REG16_CX;
-    if (strcmp(name, "DX") == 0) return REG16_DX;
-    if (strcmp(name, "SI") == 0) return REG16_SI;
-    if (strcmp(name, "DI") == 0) return REG16_DI;
-    if (strcmp(name, "BP") == 0) return REG16_BP;
-    if (strcmp(name, "SP") == 0) return REG16_SP;
-    return REG16_NONE;
+    const Keyword *keyword = keyword_find(name, (int)strlen(name));
+    return keyword != NULL && keyword->type == TOKEN_REG16 ? (Register16)keyword->reg : REG16_NONE;
 }
 
 /**
@@ -160,17 +147,12 @@ const char *get_segment_register_name(SegmentRegister reg) {
 /**
  * @brief Returns the enum value of a segment register by its name.
  *
- * @param name Null-terminated string name of the register (e.g., "DS").
+ * @param name Null-terminated string name of the register (e.g., "DS"), in any case.
  * @return SegmentRegister Corresponding enum value, or SEGREG_NONE if unknown.
  */
 SegmentRegister get_segment_register_by_name(const char *name) {
-    if (strcmp(name, "CS") == 0) return SEGREG_CS;
-    if (strcmp(name, "DS") == 0) return SEGREG_DS;
-    if (strcmp(name, "SS") == 0) return SEGREG_SS;
-    if (strcmp(name, "ES") == 0) return SEGREG_ES;
-    if (strcmp(name, "FS") == 0) return SEGREG_FS;
-    if (strcmp(name, "GS") == 0) return SEGREG_GS;
-    return SEGREG_NONE;
+    const Keyword *keyword = keyword_find(name, (int)strlen(name));
+    return keyword != NULL && keyword->type == TOKEN_SEGREG ? (SegmentRegister)keyword->reg : SEGREG_NONE;
 }
 
 
@@ -0,0 +1,341 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "include/relax.h"
+#include "include/opcode_table.h"
+#include "include/parser_handler.h"
+#include "include/stats.h"
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Short branches can only be affected by growth this many IR
+ * instructions away: every instruction is at least one byte long, and a
+ * rel8 branch reaches at most 129 bytes from its own start.
+ */
+static constexpr uint32_t BRANCH_WINDOW = 130;
+
+/**
+ * @class GrowthTree
+ * @brief Fenwick tree of how many bytes each IR instruction has grown.
+ *
+ * Widening a branch and asking how far an address has moved are both
+ * O(log n), so no pass over the IR is needed while relaxing.
+ */
+class GrowthTree
+{
+public:
+    explicit GrowthTree(size_t count) : tree(count + 1, 0) {}
+
+    /** Records that instruction index grew by amount bytes. */
+    void add(size_t index, int32_t amount)
+    {
+        for (size_t i = index + 1; i < tree.size(); i += i & (~i + 1))
+            tree[i] += amount;
+    }
+
+    /** Returns the growth of all instructions before index. */
+    int32_t before(size_t index) const
+    {
+        int32_t sum = 0;
+        for (size_t i = index; i > 0; i -= i & (~i + 1))
+            sum += tree[i];
+        return sum;
+    }
+
+private:
+    std::vector<int32_t> tree;
+};
+
+/**
+ * @struct Branch
+ * @brief A relaxable branch and its target.
+ */
+struct Branch
+{
+    uint32_t index;       /**< IR index of the branch. */
+    uint32_t barrier;     /**< Number of barriers before the branch. */
+    const IrLabel *label; /**< Target label, or nullptr for an absolute target. */
+    long absolute;        /**< Target address when label is nullptr. */
+    BranchKind kind;      /**< JMP, JCC or LOOP. */
+    bool queued;          /**< True while the branch is on the worklist. */
+};
+
+/**
+ * @class Relaxer
+ * @brief State of one branch relaxation run.
+ */
+class Relaxer
+{
+public:
+    explicit Relaxer(AsmContext &context)
+        : ctx(context), growth(context.ir.size()), barrier_delta(context.ir_barriers.size(), 0) {}
+
+    void run();
+
+private:
+    void collect();
+    void update_barriers();
+    int32_t shift(uint32_t index, uint32_t barrier);
+    bool fits(const Branch &branch);
+    void grow(Branch &branch);
+    void requeue_around(uint32_t index);
+    void finish();
+
+    AsmContext &ctx;
+    GrowthTree growth;
+    std::vector<Branch> branches;     // sorted by IR index
+    std::vector<uint32_t> worklist;   // indices into branches
+    std::vector<int32_t> barrier_delta;
+    bool barriers_dirty = false;
+    uint64_t widened = 0;
+};
+
+/**
+ * @brief Finds the relaxable branches and resolves their targets once.
+ */
+void Relaxer::collect()
+{
+    uint32_t barrier = 0;
+    for (uint32_t i = 0; i < ctx.ir.size(); i++)
+    {
+        while (barrier < ctx.ir_barriers.size() && ctx.ir_barriers[barrier].ir_index <= i)
+            barrier++;
+
+        const IrInstr &instr = ctx.ir[i];
+        const BranchKind kind = opcode_table.form(instr.form).branch;
+        if (kind != BranchKind::JMP && kind != BranchKind::JCC && kind != BranchKind::LOOP)
+            continue;
+
+        Branch branch{i, barrier, nullptr, instr.op[0].imm, kind, false};
+        if (instr.expr)
+        {
+            const IrExpr &expr = ctx.ir_exprs[instr.expr - 1];
+            branch.label = find_label(ctx, expr);
+            if (!branch.label)
+                branch.absolute = resolveSymbol(ctx, instr); // EQU value, or throws for undefined
+        }
+        branches.push_back(branch);
+    }
+}
+
+/**
+ * @brief Recomputes how far the addresses after each barrier have moved.
+ */
+void Relaxer::update_barriers()
+{
+    for (size_t k = 0; k < ctx.ir_barriers.size(); k++)
+    {
+        const IrBarrier &barrier = ctx.ir_barriers[k];
+        if (barrier.unit == 0)
+        {
+            barrier_delta[k] = 0; // ORG: absolute
+            continue;
+        }
+
+        const int32_t moved = k == 0 ? growth.before(barrier.ir_index)
+                                     : barrier_delta[k - 1] + growth.before(barrier.ir_index) -
+                                           growth.before(ctx.ir_barriers[k - 1].ir_index);
+        const int32_t start = barrier.start + moved;
+        const int count = evaluateExpr(barrier.expr, start, barrier.base);
+        if (count < 0)
+            throw AssemblyError("Negative count in times directive");
+        barrier_delta[k] = start + count * barrier.unit - barrier.end;
+    }
+    barriers_dirty = false;
+}
+
+/**
+ * @brief Returns how far a position has moved since pass 1.
+ *
+ * @param index IR index of the position.
+ * @param barrier Number of barriers before the position.
+ */
+int32_t Relaxer::shift(uint32_t index, uint32_t barrier)
+{
+    if (barrier == 0)
+        return growth.before(index);
+    if (barriers_dirty)
+        update_barriers();
+    const IrBarrier &last = ctx.ir_barriers[barrier - 1];
+    return barrier_delta[barrier - 1] + growth.before(index) - growth.before(last.ir_index);
+}
+
+bool Relaxer::fits(const Branch &branch)
+{
+    const IrInstr &instr = ctx.ir[branch.index];
+    const long end = static_cast<long>(instr.address) + shift(branch.index, branch.barrier) + instr.size;
+    const long target = branch.label ? branch.label->address + shift(branch.label->anchor, branch.label->barrier)
+                                     : branch.absolute;
+    const long rel = target - end;
+    return rel >= -128 && rel <= 127;
+}
+
+void Relaxer::grow(Branch &branch)
+{
+    IrInstr &instr = ctx.ir[branch.index];
+    if (branch.kind == BranchKind::LOOP)
+        throw AssemblyError("LOOP target out of range (line " + std::to_string(instr.line) + ")");
+
+    const uint8_t size = branch.kind == BranchKind::JMP ? 3 : 5; // E9 rel16 / J!cc +3, E9 rel16
+    growth.add(branch.index, size - instr.size);
+    instr.size = size;
+    barriers_dirty = !ctx.ir_barriers.empty();
+    widened++;
+}
+
+/**
+ * @brief Puts back the short branches whose distance changed because the
+ * instruction at index grew.
+ */
+void Relaxer::requeue_around(uint32_t index)
+{
+    const uint32_t first = index > BRANCH_WINDOW ? index - BRANCH_WINDOW : 0;
+    auto it = std::lower_bound(branches.begin(), branches.end(), first,
+                               [](const Branch &b, uint32_t i)
+                               { return b.index < i; });
+
+    for (; it != branches.end() && it->index <= index + BRANCH_WINDOW; ++it)
+    {
+        if (it->queued || ctx.ir[it->index].size != 2)
+            continue;
+
+        // The distance covers the instructions between the end of the
+        // branch and its target
+        const uint32_t from = it->index + 1;
+        bool crossed;
+        if (it->label)
+        {
+            const uint32_t to = it->label->anchor;
+            crossed = index >= std::min(from, to) && index < std::max(from, to);
+        }
+        else
+        {
+            crossed = index < from;
+        }
+
+        if (crossed)
+        {
+            it->queued = true;
+            worklist.push_back(static_cast<uint32_t>(it - branches.begin()));
+        }
+    }
+}
+
+/**
+ * @brief Moves the IR instructions, labels and data to their final addresses.
+ */
+void Relaxer::finish()
+{
+    if (barriers_dirty)
+        update_barriers();
+
+    int32_t moved = 0;
+    size_t barrier = 0;
+    for (uint32_t i = 0; i < ctx.ir.size(); i++)
+    {
+        while (barrier < ctx.ir_barriers.size() && ctx.ir_barriers[barrier].ir_index == i)
+            moved = barrier_delta[barrier++];
+        const uint8_t size = ctx.ir[i].size;
+        ctx.ir[i].address = static_cast<uint32_t>(static_cast<int32_t>(ctx.ir[i].address) + moved);
+        // Sizes are final, so the growth of this instruction is its size minus the pass 1 size
+        const BranchKind kind = opcode_table.form(ctx.ir[i].form).branch;
+        if (size != 2 && (kind == BranchKind::JMP || kind == BranchKind::JCC))
+            moved += size - 2;
+    }
+
+    for (IrLabel &label : ctx.label_table)
+    {
+        if (label.defined)
+            label.address += shift(label.anchor, label.barrier);
+    }
+    for (IrLocalLabel &local : ctx.local_labels)
+    {
+        if (local.label.defined)
+            local.label.address += shift(local.label.anchor, local.label.barrier);
+    }
+
+    for (IrData &data : ctx.ir_data)
+    {
+        data.address += shift(data.anchor, data.barrier);
+        if (data.padding)
+        {
+            // The padding now ends where its barrier does
+            const IrBarrier &times = ctx.ir_barriers[data.barrier];
+            const int32_t end = times.end + barrier_delta[data.barrier];
+            data.count = static_cast<uint32_t>((end - data.address) / times.unit);
+        }
+    }
+}
+
+void Relaxer::run()
+{
+    collect();
+    if (branches.empty())
+        return;
+
+    // Start optimistic: every branch is rel8 and needs one check
+    for (uint32_t b = 0; b < branches.size(); b++)
+    {
+        branches[b].queued = true;
+        worklist.push_back(b);
+    }
+
+    for (;;)
+    {
+        while (!worklist.empty())
+        {
+            Branch &branch = branches[worklist.back()];
+            worklist.pop_back();
+            branch.queued = false;
+
+            if (ctx.ir[branch.index].size != 2 || fits(branch))
+                continue;
+
+            grow(branch);
+            requeue_around(branch.index);
+        }
+
+        // Branches to absolute addresses, or across barriers, can be moved
+        // by growth outside the window; one check of the remaining short
+        // branches catches them.
+        for (uint32_t b = 0; b < branches.size(); b++)
+        {
+            if (ctx.ir[branches[b].index].size == 2 && !fits(branches[b]))
+            {
+                branches[b].queued = true;
+                worklist.push_back(b);
+            }
+        }
+        if (worklist.empty())
+            break;
+    }
+
+    finish();
+    stats_count_branches(branches.size(), widened);
+}
+
+void relax_branches(AsmContext &ctx)
+{
+    stats_phase_begin(STATS_PHASE_RELAX);
+    Relaxer relaxer(ctx);
+    relaxer.run();
+    stats_phase_end(STATS_PHASE_RELAX);
+}
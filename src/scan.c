@@ -0,0 +1,210 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// scan.c
+
+#include "include/scan.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && defined(__SSE2__)
+#define SCAN_X86 1
+#include <immintrin.h>
+#else
+#define SCAN_X86 0
+#endif
+
+/*
+ * The vector loops only read whole blocks that end at or before the end
+ * bound; the last few bytes go through the scalar loops, which stop at
+ * the first terminator. The caller makes sure one comes at or before the
+ * bound (the lexer's bound is the NUL byte after the source).
+ */
+
+static const char *line_end_scalar(const char *p)
+{
+    while (*p != '\n' && *p != '\0')
+        p++;
+    return p;
+}
+
+static const char *string_end_scalar(const char *p, char quote)
+{
+    while (*p != quote && *p != '\n' && *p != '\0')
+        p++;
+    return p;
+}
+
+static const char *skip_spaces_scalar(const char *p)
+{
+    while (*p == ' ' || *p == '\t' || *p == '\r')
+        p++;
+    return p;
+}
+
+#if SCAN_X86
+
+static const char *line_end_sse2(const char *p, const char *end)
+{
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i block = _mm_loadu_si128((const __m128i *)(const void *)p);
+        const int mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, newline),
+                                                        _mm_cmpeq_epi8(block, zero)));
+        if (mask != 0)
+            return p + __builtin_ctz((unsigned)mask);
+    }
+    return line_end_scalar(p);
+}
+
+static const char *string_end_sse2(const char *p, const char *end, char quote)
+{
+    const __m128i closing = _mm_set1_epi8(quote);
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i block = _mm_loadu_si128((const __m128i *)(const void *)p);
+        const __m128i stop = _mm_or_si128(_mm_cmpeq_epi8(block, closing),
+                                          _mm_or_si128(_mm_cmpeq_epi8(block, newline), _mm_cmpeq_epi8(block, zero)));
+        const int mask = _mm_movemask_epi8(stop);
+        if (mask != 0)
+            return p + __builtin_ctz((unsigned)mask);
+    }
+    return string_end_scalar(p, quote);
+}
+
+static const char *skip_spaces_sse2(const char *p, const char *end)
+{
+    const __m128i space = _mm_set1_epi8(' ');
+    const __m128i tab = _mm_set1_epi8('\t');
+    const __m128i cr = _mm_set1_epi8('\r');
+    for (; end - p >= 16; p += 16)
+    {
+        const __m128i block = _mm_loadu_si128((const __m128i *)(const void *)p);
+        const __m128i blank = _mm_or_si128(_mm_cmpeq_epi8(block, space),
+                                           _mm_or_si128(_mm_cmpeq_epi8(block, tab), _mm_cmpeq_epi8(block, cr)));
+        const unsigned other = ~(unsigned)_mm_movemask_epi8(blank) & 0xFFFFu;
+        if (other != 0)
+            return p + __builtin_ctz(other);
+    }
+    return skip_spaces_scalar(p);
+}
+
+__attribute__((target("avx2"))) static const char *line_end_avx2(const char *p, const char *end)
+{
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i zero = _mm256_setzero_si256();
+    for (; end - p >= 32; p += 32)
+    {
+        const __m256i block = _mm256_loadu_si256((const __m256i *)(const void *)p);
+        const int mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(block, newline),
+                                                              _mm256_cmpeq_epi8(block, zero)));
+        if (mask != 0)
+            return p + __builtin_ctz((unsigned)mask);
+    }
+    return line_end_sse2(p, end);
+}
+
+__attribute__((target("avx2"))) static const char *string_end_avx2(const char *p, const char *end, char quote)
+{
+    const __m256i closing = _mm256_set1_epi8(quote);
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i zero = _mm256_setzero_si256();
+    for (; end - p >= 32; p += 32)
+    {
+        const __m256i block = _mm256_loadu_si256((const __m256i *)(const void *)p);
+        const __m256i stop = _mm256_or_si256(_mm256_cmpeq_epi8(block, closing),
+                                             _mm256_or_si256(_mm256_cmpeq_epi8(block, newline),
+                                                             _mm256_cmpeq_epi8(block, zero)));
+        const int mask = _mm256_movemask_epi8(stop);
+        if (mask != 0)
+            return p + __builtin_ctz((unsigned)mask);
+    }
+    return string_end_sse2(p, end, quote);
+}
+
+__attribute__((target("avx2"))) static const char *skip_spaces_avx2(const char *p, const char *end)
+{
+    const __m256i space = _mm256_set1_epi8(' ');
+    const __m256i tab = _mm256_set1_epi8('\t');
+    const __m256i cr = _mm256_set1_epi8('\r');
+    for (; end - p >= 32; p += 32)
+    {
+        const __m256i block = _mm256_loadu_si256((const __m256i *)(const void *)p);
+        const __m256i blank = _mm256_or_si256(_mm256_cmpeq_epi8(block, space),
+                                              _mm256_or_si256(_mm256_cmpeq_epi8(block, tab),
+                                                              _mm256_cmpeq_epi8(block, cr)));
+        const unsigned other = ~(unsigned)_mm256_movemask_epi8(blank);
+        if (other != 0)
+            return p + __builtin_ctz(other);
+    }
+    return skip_spaces_sse2(p, end);
+}
+
+/**
+ * @brief Returns non-zero if the AVX2 versions can be used.
+ *
+ * The CPU is checked on every call; the answer comes from a table libgcc
+ * fills in at startup, so this is only a load and a test.
+ */
+static int have_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif // SCAN_X86
+
+const char *scan_line_end(const char *p, const char *end)
+{
+#if SCAN_X86
+    return have_avx2() ? line_end_avx2(p, end) : line_end_sse2(p, end);
+#else
+    (void)end;
+    return line_end_scalar(p);
+#endif
+}
+
+const char *scan_string_end(const char *p, const char *end, char quote)
+{
+#if SCAN_X86
+    return have_avx2() ? string_end_avx2(p, end, quote) : string_end_sse2(p, end, quote);
+#else
+    (void)end;
+    return string_end_scalar(p, quote);
+#endif
+}
+
+const char *scan_skip_spaces(const char *p, const char *end)
+{
+#if SCAN_X86
+    return have_avx2() ? skip_spaces_avx2(p, end) : skip_spaces_sse2(p, end);
+#else
+    (void)end;
+    return skip_spaces_scalar(p);
+#endif
+}
+
+const char *scan_implementation(void)
+{
+#if SCAN_X86
+    return have_avx2() ? "avx2" : "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,133 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// source.c
+
+#if !defined(_WIN32)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include "include/source.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/**
+ * @brief Reads a whole file into a heap buffer with a NUL byte appended.
+ */
+static int source_read(const char *path, SourceBuffer *source)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == NULL)
+        return -1;
+
+    size_t capacity = 4096;
+    size_t size = 0;
+    char *data = malloc(capacity);
+
+    while (data != NULL)
+    {
+        size_t n = fread(data + size, 1, capacity - size - 1, file);
+        size += n;
+        if (n == 0)
+            break;
+        if (capacity - size - 1 == 0)
+        {
+            char *grown = realloc(data, capacity * 2);
+            if (grown == NULL)
+            {
+                free(data);
+                data = NULL;
+                break;
+            }
+            data = grown;
+            capacity *= 2;
+        }
+    }
+
+    int failed = (data == NULL) || ferror(file);
+    fclose(file);
+    if (failed)
+    {
+        errno = data == NULL ? ENOMEM : EIO;
+        free(data);
+        return -1;
+    }
+
+    data[size] = '\0';
+    source->data = data;
+    source->size = size;
+    source->mapped = 0;
+    return 0;
+}
+
+int source_load(const char *path, SourceBuffer *source)
+{
+#if !defined(_WIN32)
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return -1;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0)
+    {
+        size_t size = (size_t)st.st_size;
+        long page = sysconf(_SC_PAGESIZE);
+
+        // The bytes after the end of the file in its last page read as zero,
+        // which gives the NUL terminator for free unless the size is a
+        // multiple of the page size.
+        if (page > 0 && size % (size_t)page != 0)
+        {
+            void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map != MAP_FAILED)
+            {
+                close(fd);
+                source->data = (const char *)map;
+                source->size = size;
+                source->mapped = 1;
+                return 0;
+            }
+        }
+    }
+    close(fd);
+#endif
+
+    return source_read(path, source);
+}
+
+void source_release(SourceBuffer *source)
+{
+#if !defined(_WIN32)
+    if (source->mapped)
+    {
+        munmap((void *)source->data, source->size);
+        source->data = NULL;
+        return;
+    }
+#endif
+    free((void *)source->data);
+    source->data = NULL;
+}
@@ -0,0 +1,350 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "include/stats.h"
+#include "include/scan.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+using stats_clock = std::chrono::steady_clock;
+
+// Totals are shared by all worker threads; the running phases are per
+// thread, so phases of files assembled in parallel add up. Phases nest,
+// and time is charged to the innermost running one.
+static bool enabled = false;
+static stats_clock::time_point enabled_at;
+static std::atomic<uint64_t> instructions{0};
+static std::atomic<uint64_t> lines{0};
+static std::atomic<uint64_t> files{0};
+static std::atomic<uint64_t> source_bytes{0};
+static std::atomic<uint64_t> branches{0};
+static std::atomic<uint64_t> branches_widened{0};
+static std::atomic<uint64_t> arena_blocks{0};
+static std::atomic<uint64_t> arena_bytes{0};
+static std::atomic<uint64_t> cache_lookups{0};
+static std::atomic<uint64_t> cache_hits{0};
+static std::atomic<uint64_t> phase_ns[STATS_PHASE_COUNT] = {};
+static std::atomic<uint64_t> phase_allocs[STATS_PHASE_COUNT] = {};
+static thread_local StatsPhase phase_stack[STATS_PHASE_COUNT];
+static thread_local int phase_depth = 0;
+static thread_local stats_clock::time_point phase_start;
+static thread_local uint64_t phase_allocs_start;
+
+static std::atomic<bool> counting{false};
+static std::atomic<uint64_t> allocations{0};
+static thread_local uint64_t thread_allocations = 0;
+
+/*
+ * Replacement global allocation functions. They count calls, while
+ * statistics are on, so that --stats can show how many heap allocations
+ * each phase makes; otherwise the only cost is one relaxed load. Every
+ * form is replaced, so whichever new a block came from, the matching
+ * delete frees it the same way.
+ */
+static void *allocate(std::size_t size, std::size_t alignment) noexcept
+{
+    if (counting.load(std::memory_order_relaxed))
+    {
+        allocations.fetch_add(1, std::memory_order_relaxed);
+        thread_allocations++;
+    }
+    if (size == 0)
+        size = 1;
+    if (alignment <= __STDCPP_DEFAULT_NEW_ALIGNMENT__)
+        return std::malloc(size);
+    // aligned_alloc wants a size that is a multiple of the alignment
+    return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+static void *allocate_or_throw(std::size_t size, std::size_t alignment)
+{
+    void *ptr = allocate(size, alignment);
+    if (!ptr)
+        throw std::bad_alloc();
+    return ptr;
+}
+
+void *operator new(std::size_t size)
+{
+    return allocate_or_throw(size, 0);
+}
+
+void *operator new[](std::size_t size)
+{
+    return allocate_or_throw(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return allocate_or_throw(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size, 0);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &) noexcept
+{
+    return allocate(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept
+{
+    return allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::size_t, std::align_val_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void *ptr, std::align_val_t, const std::nothrow_t &) noexcept
+{
+    std::free(ptr);
+}
+
+unsigned long long stats_allocations(void)
+{
+    return allocations.load(std::memory_order_relaxed);
+}
+
+static const char *const phase_names[STATS_PHASE_COUNT] = {
+    "lex", "parse", "relax", "encode"};
+
+void stats_enable(void)
+{
+    enabled = true;
+    counting.store(true, std::memory_order_relaxed);
+    enabled_at = stats_clock::now();
+}
+
+int stats_enabled(void)
+{
+    return enabled ? 1 : 0;
+}
+
+void stats_count_instructions(unsigned long long count)
+{
+    instructions.fetch_add(count, std::memory_order_relaxed);
+}
+
+void stats_count_line(void)
+{
+    lines.fetch_add(1, std::memory_order_relaxed);
+}
+
+void stats_count_branches(unsigned long long total, unsigned long long widened)
+{
+    branches.fetch_add(total, std::memory_order_relaxed);
+    branches_widened.fetch_add(widened, std::memory_order_relaxed);
+}
+
+void stats_count_file(void)
+{
+    files.fetch_add(1, std::memory_order_relaxed);
+}
+
+void stats_count_source_bytes(unsigned long long count)
+{
+    source_bytes.fetch_add(count, std::memory_order_relaxed);
+}
+
+void stats_count_arena_block(unsigned long long bytes)
+{
+    arena_blocks.fetch_add(1, std::memory_order_relaxed);
+    arena_bytes.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void stats_count_encode_cache(unsigned long long lookups, unsigned long long hits)
+{
+    cache_lookups.fetch_add(lookups, std::memory_order_relaxed);
+    cache_hits.fetch_add(hits, std::memory_order_relaxed);
+}
+
+/**
+ * @brief Adds the time and allocations since the last switch to the innermost running phase.
+ */
+static void charge_running_phase(stats_clock::time_point now)
+{
+    const StatsPhase phase = phase_stack[phase_depth - 1];
+    phase_ns[phase].fetch_add(static_cast<uint64_t>(
+                                  std::chrono::duration_cast<std::chrono::nanoseconds>(now - phase_start).count()),
+                              std::memory_order_relaxed);
+    phase_allocs[phase].fetch_add(thread_allocations - phase_allocs_start, std::memory_order_relaxed);
+    phase_start = now;
+    phase_allocs_start = thread_allocations;
+}
+
+void stats_phase_begin(StatsPhase phase)
+{
+    if (!enabled)
+        return;
+    const stats_clock::time_point now = stats_clock::now();
+    if (phase_depth > 0)
+        charge_running_phase(now);
+
+    // A phase left running by an error restarts here
+    for (int i = 0; i < phase_depth; i++)
+    {
+        if (phase_stack[i] == phase)
+        {
+            phase_depth = i;
+            break;
+        }
+    }
+
+    phase_stack[phase_depth++] = phase;
+    phase_start = now;
+    phase_allocs_start = thread_allocations;
+}
+
+void stats_phase_end(StatsPhase phase)
+{
+    if (!enabled || phase_depth == 0 || phase_stack[phase_depth - 1] != phase)
+        return;
+    charge_running_phase(stats_clock::now());
+    phase_depth--;
+}
+
+void stats_phase_abort(void)
+{
+    if (!enabled || phase_depth == 0)
+        return;
+    charge_running_phase(stats_clock::now());
+    phase_depth = 0;
+}
+
+/**
+ * @brief Returns how many items per second were processed in the given time.
+ */
+static double per_second(uint64_t count, uint64_t ns)
+{
+    return ns ? static_cast<double>(count) * 1e9 / static_cast<double>(ns) : 0.0;
+}
+
+void stats_report(void)
+{
+    if (!enabled)
+        return;
+
+    const uint64_t wall_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(stats_clock::now() - enabled_at).count());
+    const uint64_t line_count = lines.load();
+    const uint64_t parse_allocs = phase_allocs[STATS_PHASE_PARSE].load();
+
+    std::fprintf(stderr, "\n--- EASM statistics ---\n");
+    for (int i = 0; i < STATS_PHASE_COUNT; i++)
+    {
+        std::fprintf(stderr, "%-8s %10.3f ms %10llu allocations\n", phase_names[i],
+                     static_cast<double>(phase_ns[i].load()) / 1e6,
+                     static_cast<unsigned long long>(phase_allocs[i].load()));
+    }
+    std::fprintf(stderr, "source: %.3f MB (%.1f MB/s lexed, %s scanning)\n",
+                 static_cast<double>(source_bytes.load()) / 1e6,
+                 per_second(source_bytes.load(), phase_ns[STATS_PHASE_LEX].load()) / 1e6,
+                 scan_implementation());
+    std::fprintf(stderr, "lines: %llu (%.0f lines/s parsed, %.3f allocations/line)\n",
+                 static_cast<unsigned long long>(line_count),
+                 per_second(line_count, phase_ns[STATS_PHASE_PARSE].load()),
+                 line_count ? static_cast<double>(parse_allocs) / static_cast<double>(line_count) : 0.0);
+    std::fprintf(stderr, "heap allocations: %llu total (%llu arena blocks, %.3f MB)\n", stats_allocations(),
+                 static_cast<unsigned long long>(arena_blocks.load()),
+                 static_cast<double>(arena_bytes.load()) / 1e6);
+    std::fprintf(stderr, "instructions: %llu (%.0f instr/s encoded)\n",
+                 static_cast<unsigned long long>(instructions.load()),
+                 per_second(instructions.load(), phase_ns[STATS_PHASE_ENCODE].load()));
+    std::fprintf(stderr, "encode cache: %llu hits of %llu lookups (%.1f%% hit rate)\n",
+                 static_cast<unsigned long long>(cache_hits.load()),
+                 static_cast<unsigned long long>(cache_lookups.load()),
+                 cache_lookups.load() ? 100.0 * static_cast<double>(cache_hits.load()) /
+                                            static_cast<double>(cache_lookups.load())
+                                      : 0.0);
+    std::fprintf(stderr, "branches: %llu (%llu rel8, %llu widened)\n",
+                 static_cast<unsigned long long>(branches.load()),
+                 static_cast<unsigned long long>(branches.load() - branches_widened.load()),
+                 static_cast<unsigned long long>(branches_widened.load()));
+    std::fprintf(stderr, "files: %llu in %.3f ms wall (%.1f files/s)\n",
+                 static_cast<unsigned long long>(files.load()),
+                 static_cast<double>(wall_ns) / 1e6,
+                 per_second(files.load(), wall_ns));
+}
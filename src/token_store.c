@@ -0,0 +1,236 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// token_store.c
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "include/token_store.h"
+
+void token_store_init(TokenStore *store, const char *source)
+{
+    store->source = source;
+    store->kinds = NULL;
+    store->payloads = NULL;
+    store->offsets = NULL;
+    store->lengths = NULL;
+    store->count = 0;
+    store->capacity = 0;
+    store->line_ends = NULL;
+    store->line_numbers = NULL;
+    store->line_count = 0;
+    store->line_capacity = 0;
+    interner_init(&store->symbols, source);
+}
+
+void token_store_free(TokenStore *store)
+{
+    free(store->kinds);
+    free(store->payloads);
+    free(store->offsets);
+    free(store->lengths);
+    free(store->line_ends);
+    free(store->line_numbers);
+    interner_free(&store->symbols);
+    token_store_init(store, store->source);
+}
+
+/**
+ * @brief Resizes the token arrays to the given number of tokens.
+ */
+static int reserve_tokens(TokenStore *store, size_t capacity)
+{
+    unsigned char *kinds = realloc(store->kinds, capacity);
+    if (kinds == NULL)
+        return -1;
+    store->kinds = kinds;
+
+    int32_t *payloads = realloc(store->payloads, capacity * sizeof *payloads);
+    if (payloads == NULL)
+        return -1;
+    store->payloads = payloads;
+
+    uint32_t *offsets = realloc(store->offsets, capacity * sizeof *offsets);
+    if (offsets == NULL)
+        return -1;
+    store->offsets = offsets;
+
+    uint32_t *lengths = realloc(store->lengths, capacity * sizeof *lengths);
+    if (lengths == NULL)
+        return -1;
+    store->lengths = lengths;
+
+    store->capacity = capacity;
+    return 0;
+}
+
+/**
+ * @brief Resizes the line arrays to the given number of lines.
+ */
+static int reserve_lines(TokenStore *store, size_t capacity)
+{
+    uint32_t *line_ends = realloc(store->line_ends, capacity * sizeof *line_ends);
+    if (line_ends == NULL)
+        return -1;
+    store->line_ends = line_ends;
+
+    uint32_t *line_numbers = realloc(store->line_numbers, capacity * sizeof *line_numbers);
+    if (line_numbers == NULL)
+        return -1;
+    store->line_numbers = line_numbers;
+
+    store->line_capacity = capacity;
+    return 0;
+}
+
+int token_store_reserve(TokenStore *store, size_t tokens, size_t lines)
+{
+    if (tokens > store->capacity && reserve_tokens(store, tokens) != 0)
+        return -1;
+    if (lines > store->line_capacity && reserve_lines(store, lines) != 0)
+        return -1;
+    return 0;
+}
+
+int token_store_map_symbols(TokenStore *dest, const TokenStore *src, uint32_t *map)
+{
+    const Interner *names = &src->symbols;
+    for (uint32_t id = 0; id < names->count; id++)
+    {
+        map[id] = interner_intern(&dest->symbols, names->source + names->offsets[id], names->lengths[id]);
+        if (map[id] == INTERNER_NO_ID)
+        {
+            errno = ENOMEM;
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void token_store_copy(TokenStore *dest, size_t token_at, size_t line_at, const TokenStore *src, uint32_t line_base,
+                      const uint32_t *symbol_map)
+{
+    memcpy(dest->kinds + token_at, src->kinds, src->count);
+    memcpy(dest->offsets + token_at, src->offsets, src->count * sizeof *src->offsets);
+    memcpy(dest->lengths + token_at, src->lengths, src->count * sizeof *src->lengths);
+
+    for (size_t i = 0; i < src->line_count; i++)
+    {
+        dest->line_ends[line_at + i] = src->line_ends[i] + (uint32_t)token_at;
+        dest->line_numbers[line_at + i] = src->line_numbers[i] + line_base;
+    }
+
+    for (size_t i = 0; i < src->count; i++)
+    {
+        int32_t payload = src->payloads[i];
+        if (src->kinds[i] == TOKEN_LABEL)
+            payload = (int32_t)symbol_map[payload];
+        else if (src->kinds[i] == TOKEN_INSTR && payload < 0)
+            payload = (int32_t)~symbol_map[~payload];
+        dest->payloads[token_at + i] = payload;
+    }
+}
+
+/**
+ * @brief Returns the one field of a token that its kind gives a meaning to.
+ *
+ * Labels and plain identifiers are given their symbol id by the caller.
+ */
+static int32_t token_payload(const Token *token)
+{
+    switch (token->type)
+    {
+    case TOKEN_INSTR:
+        return (int32_t)token->instr_type;
+    case TOKEN_REG8:
+        return (int32_t)token->t_register8;
+    case TOKEN_REG16:
+        return (int32_t)token->t_register16;
+    case TOKEN_SEGREG:
+        return (int32_t)token->t_segregister;
+    case TOKEN_NUMBER:
+    case TOKEN_STRING:
+        return (int32_t)token->value;
+    default:
+        return 0;
+    }
+}
+
+int token_store_fill(TokenStore *store, Lexer *lexer)
+{
+    // Offsets and lengths are 32 bits wide
+    if ((size_t)(lexer->end - store->source) > UINT32_MAX)
+    {
+        errno = EFBIG;
+        return -1;
+    }
+
+    // About one token per four bytes of source and one line per sixteen
+    const size_t remaining = (size_t)(lexer->end - lexer->cursor);
+    if (token_store_reserve(store, store->count + remaining / 4 + 16, store->line_count + remaining / 16 + 16) != 0)
+        return -1;
+
+    size_t line_start = store->line_count ? store->line_ends[store->line_count - 1] : 0;
+    for (Token token = lexer_next(lexer); token.type != TOKEN_EOF; token = lexer_next(lexer))
+    {
+        if (token.type == TOKEN_COMMENT)
+            continue;
+        if (token.type == TOKEN_EOL && store->count == line_start)
+            continue; // empty line
+
+        if (store->count == store->capacity && reserve_tokens(store, store->capacity * 2) != 0)
+            return -1;
+        const size_t i = store->count++;
+        store->kinds[i] = (unsigned char)token.type;
+        store->payloads[i] = token_payload(&token);
+        if (token.type == TOKEN_LABEL || (token.type == TOKEN_INSTR && token.instr_type == INSTR_GENERIC))
+        {
+            const uint32_t id = interner_intern(&store->symbols, token.lexeme, (uint32_t)token.length);
+            if (id == INTERNER_NO_ID)
+            {
+                errno = ENOMEM;
+                return -1;
+            }
+            store->payloads[i] = token.type == TOKEN_LABEL ? (int32_t)id : (int32_t)~id;
+        }
+        else if (i > 0 && store->kinds[i - 1] == TOKEN_DOT && token.type != TOKEN_EOL)
+        {
+            // A local label reference may be spelled like a keyword (.loop);
+            // intern its name so the parser can look it up
+            if (interner_intern(&store->symbols, token.lexeme, (uint32_t)token.length) == INTERNER_NO_ID)
+            {
+                errno = ENOMEM;
+                return -1;
+            }
+        }
+        store->offsets[i] = (uint32_t)(token.lexeme - store->source);
+        store->lengths[i] = (uint32_t)token.length;
+
+        if (token.type == TOKEN_EOL)
+        {
+            if (store->line_count == store->line_capacity && reserve_lines(store, store->line_capacity * 2) != 0)
+                return -1;
+            store->line_ends[store->line_count] = (uint32_t)store->count;
+            store->line_numbers[store->line_count] = (uint32_t)token.line;
+            store->line_count++;
+            line_start = store->count;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*
+    EASM, Eren's Educational Assembler Project
+    Copyright (C) 2025 Habil Eren Türker
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU Affero General Public License as
+    published by the Free Software Foundation, either version 3 of the
+    License, or (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU Affero General Public License for more details.
+
+    You should have received a copy of the GNU Affero General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+// Checks that pass 1 and pass 2 make no heap allocation per source line.
+
+#include "../src/include/asm_context.h"
+#include "../src/include/parser.h"
+#include "../src/include/parser_handler.h"
+#include "../src/include/relax.h"
+#include "../src/include/stats.h"
+#include <cstdio>
+#include <exception>
+#include <memory>
+#include <string>
+
+/**
+ * @brief One block of the generated source: a line of each kind pass 1 handles.
+ */
+static const char *const block =
+    "label%d:\n"
+    " mov ax, 0x1234\n"
+    " mov si, [bx+di+8]\n"
+    " mov [bp-2], ax\n"
+    " mov di, es:[si]\n"
+    " add ax, 5\n"
+    " mov si, msg%d\n"
+    ".loop:\n"
+    " jne .loop\n"
+    " jmp label%d\n"
+    "msg%d db 'hello', 0, 1\n"
+    "val%d dw 0x1234, -1\n"
+    "size%d equ 7\n"
+    " nop\n";
+
+/** Lines in one block. */
+static constexpr int BLOCK_LINES = 13;
+
+/**
+ * @brief Heap allocations made by the phases of one assembly.
+ */
+struct PhaseAllocations
+{
+    unsigned long long parse;
+    unsigned long long encode;
+};
+
+/**
+ * @brief Assembles blocks copies of the block and counts the allocations of pass 1 and pass 2.
+ */
+static PhaseAllocations assemble(int blocks)
+{
+    std::string source;
+    char buffer[512];
+    for (int i = 0; i < blocks; i++)
+    {
+        std::snprintf(buffer, sizeof(buffer), block, i, i, i, i, i, i);
+        source += buffer;
+    }
+
+    AsmContext ctx;
+    ctx.filename = "alloc_test";
+    ctx.listing = false;
+    Lexer lexer;
+    lexer_init(&lexer, source.c_str(), source.size(), "alloc_test");
+    token_store_init(&ctx.tokens, source.c_str());
+    if (token_store_fill(&ctx.tokens, &lexer) != 0)
+        throw AssemblyError("cannot store the tokens");
+
+    PhaseAllocations counts{};
+    unsigned long long start = stats_allocations();
+    parser_process_lines(ctx, 1);
+    counts.parse = stats_allocations() - start;
+
+    relax_branches(ctx);
+    start = stats_allocations();
+    encodeInstructions(ctx);
+    counts.encode = stats_allocations() - start;
+
+    token_store_free(&ctx.tokens);
+    if (ctx.failed || ctx.ir.size() != static_cast<size_t>(blocks) * 9)
+        throw AssemblyError("the generated source did not assemble: " + ctx.diagnostics.str());
+    return counts;
+}
+
+/**
+ * @brief Fails the test if a phase made one allocation per hundred lines or more.
+ */
+static bool check(const char *phase, unsigned long long allocations, int lines)
+{
+    const bool ok = allocations * 100 < static_cast<unsigned long long>(lines);
+    std::printf("%-6s %8d lines %6llu allocations %s\n", phase, lines, allocations, ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main()
+{
+    try
+    {
+        stats_enable();
+
+        // The counter has to see the allocations this test makes itself
+        const unsigned long long before = stats_allocations();
+        auto probe = std::make_unique<int>(0);
+        if (stats_allocations() != before + 1)
+        {
+            std::fprintf(stderr, "alloc_test: operator new is not counted\n");
+            return 1;
+        }
+
+        bool ok = true;
+        for (int blocks : {1000, 10000})
+        {
+            const PhaseAllocations counts = assemble(blocks);
+            ok &= check("parse", counts.parse, blocks * BLOCK_LINES);
+            ok &= check("encode", counts.encode, blocks * BLOCK_LINES);
+        }
+        return ok ? 0 : 1;
+    }
+    catch (const std::exception &ex)
+    {
+        std::fprintf(stderr, "alloc_test: %s\n", ex.what());
+        return 1;
+    }
+}